@@ -0,0 +1,469 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QCoreApplication>
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QImageWriter>
+#include <QLinearGradient>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QTextStream>
+#include <QtMath>
+
+#include <functional>
+#include <limits>
+
+#include "src/backend/PngEncoder.h"
+#include "src/backend/PngRowFilter.h"
+#include "src/painter/PainterItemIndex.h"
+#include "src/painter/PainterMarker.h"
+#include "src/painter/PainterPen.h"
+
+/*
+ * Timings for the hot paths of saving and annotating. Build with
+ * -DBUILD_BENCHMARKS=ON and run ksnip-benchmark, optionally with the number of
+ * repetitions, the best run of each case is reported.
+ */
+
+static QTextStream out(stdout);
+
+static qint64 bestOf(int repetitions, const std::function<void()> &run)
+{
+    auto best = std::numeric_limits<qint64>::max();
+    for (auto i = 0; i < repetitions; i++) {
+        QElapsedTimer timer;
+        timer.start();
+        run();
+        best = qMin(best, timer.nsecsElapsed());
+    }
+    return best;
+}
+
+static void report(const QString &name, qint64 nsecs, const QString &detail = QString())
+{
+    out << qSetFieldWidth(40) << left << name << qSetFieldWidth(0)
+        << QString::number(nsecs / 1000000.0, 'f', 2) << " ms";
+    if (!detail.isEmpty()) {
+        out << "  " << detail;
+    }
+    out << endl;
+}
+
+/*
+ * Something close to a screenshot, large flat areas, a few gradients and some
+ * noisy regions standing in for text and photos.
+ */
+static QImage createScreenshot(const QSize &size)
+{
+    QImage image(size, QImage::Format_ARGB32);
+    image.fill(QColor(240, 240, 240));
+
+    QPainter painter(&image);
+    QLinearGradient gradient(0, 0, 0, 64);
+    gradient.setColorAt(0, QColor(70, 90, 130));
+    gradient.setColorAt(1, QColor(40, 50, 80));
+    painter.fillRect(0, 0, size.width(), 64, gradient);
+    painter.fillRect(0, 64, 300, size.height() - 64, QColor(220, 225, 230));
+    painter.end();
+
+    qsrand(1);
+    for (auto y = 100; y < size.height() - 100; y += 24) {
+        for (auto row = 0; row < 12; row++) {
+            auto line = reinterpret_cast<QRgb*>(image.scanLine(y + row));
+            for (auto x = 340; x < size.width() / 2; x++) {
+                if (qrand() % 3 == 0) {
+                    auto gray = qrand() % 256;
+                    line[x] = qRgb(gray, gray, gray);
+                }
+            }
+        }
+    }
+    for (auto y = size.height() / 2; y < size.height() - 100; y++) {
+        auto line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (auto x = size.width() / 2 + 40; x < size.width() - 40; x++) {
+            line[x] = qRgb((x + qrand() % 16) % 256, (y + qrand() % 16) % 256, (x + y) % 256);
+        }
+    }
+    return image;
+}
+
+static void benchmarkPng(int repetitions)
+{
+    auto image = createScreenshot(QSize(3840, 2160));
+
+    auto rowSize = image.width() * 4;
+    QByteArray packed(rowSize, 0);
+    QByteArray previous(rowSize, 0);
+    QByteArray filtered(rowSize + 1, 0);
+    auto filterTime = bestOf(repetitions, [&]() {
+        PngRowFilter filter(rowSize, 4);
+        for (auto y = 0; y < image.height(); y++) {
+            memcpy(packed.data(), image.constScanLine(y), rowSize);
+            filter.filter(reinterpret_cast<const uchar*>(packed.constData()),
+                          y > 0 ? reinterpret_cast<const uchar*>(previous.constData()) : nullptr,
+                          reinterpret_cast<uchar*>(filtered.data()));
+            qSwap(packed, previous);
+        }
+    });
+    report(QString("PngRowFilter (%1)").arg(PngRowFilter::implementation()), filterTime);
+
+    QByteArray data;
+    auto writerTime = bestOf(repetitions, [&]() {
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+        QImageWriter writer(&buffer, "png");
+        writer.write(image);
+    });
+    report("QImageWriter", writerTime, QString("%1 bytes").arg(data.size()));
+
+    PngEncoder encoder;
+    QList<int> threadCounts = { 1, encoder.threadCount() };
+    for (auto threadCount : threadCounts) {
+        encoder.setThreadCount(threadCount);
+        auto encoderTime = bestOf(repetitions, [&]() {
+            QBuffer buffer(&data);
+            buffer.open(QIODevice::WriteOnly);
+            encoder.write(image, &buffer);
+        });
+        report(QString("PngEncoder, %1 threads").arg(threadCount), encoderTime, QString("%1 bytes").arg(data.size()));
+    }
+}
+
+/*
+ * Like bestOf(), but prepare runs before every repetition and isn't timed.
+ */
+static qint64 bestOf(int repetitions, const std::function<void()> &prepare, const std::function<void()> &run)
+{
+    auto best = std::numeric_limits<qint64>::max();
+    for (auto i = 0; i < repetitions; i++) {
+        prepare();
+        QElapsedTimer timer;
+        timer.start();
+        run();
+        best = qMin(best, timer.nsecsElapsed());
+    }
+    return best;
+}
+
+/*
+ * The three kinds of lookups of the paint area on 10000 short strokes, each
+ * done by scanning all items and through the index. Point lookups only count
+ * bounding rect hits, erasing removes the first item under each position of
+ * an eraser sweep, like eraseItemAt(), and selecting checks the shape of
+ * every candidate against a rubber band, like setSelectionArea().
+ */
+static void benchmarkItemIndex(int repetitions)
+{
+    QList<PainterPen*> pens;
+    qsrand(2);
+    for (auto i = 0; i < 10000; i++) {
+        QPointF position(qrand() % 3800, qrand() % 2100);
+        auto pen = new PainterPen(position, QPen(Qt::red, 3));
+        for (auto j = 0; j < 10; j++) {
+            position += QPointF(qrand() % 9 - 4, qrand() % 9 - 4);
+            pen->addPoint(position);
+        }
+        pen->finish();
+        pens.append(pen);
+    }
+
+    PainterItemIndex index;
+    auto fillIndex = [&]() {
+        index.clear();
+        for (auto pen : pens) {
+            index.markItemDirty(pen);
+        }
+        index.items(QRectF());
+    };
+    fillIndex();
+
+    QList<QRectF> queries;
+    for (auto i = 0; i < 10000; i++) {
+        queries.append(QRectF(qrand() % 3840, qrand() % 2160, 10, 10));
+    }
+
+    auto found = 0;
+    auto scanTime = bestOf(repetitions, [&]() {
+        found = 0;
+        for (const auto& query : queries) {
+            for (auto pen : pens) {
+                if (pen->sceneBoundingRect().intersects(query)) {
+                    found++;
+                }
+            }
+        }
+    });
+    report("Item lookup, linear scan", scanTime, QString("%1 hits").arg(found));
+
+    auto indexTime = bestOf(repetitions, [&]() {
+        found = 0;
+        for (const auto& query : queries) {
+            found += index.items(query).count();
+        }
+    });
+    report("Item lookup, PainterItemIndex", indexTime, QString("%1 hits").arg(found));
+
+    // Eraser sweeps across the screen, ten pixels apart
+    QList<QPointF> erasePositions;
+    for (auto y = 20; y < 2160; y += 120) {
+        for (auto x = 0; x < 3840; x += 10) {
+            erasePositions.append(QPointF(x, y));
+        }
+    }
+    QSize eraserSize(10, 10);
+
+    QList<PainterPen*> remaining;
+    auto erased = 0;
+    auto eraseScanTime = bestOf(repetitions, [&]() {
+        remaining = pens;
+    }, [&]() {
+        erased = 0;
+        for (const auto& position : erasePositions) {
+            QRectF rect(position - QPointF(5, 5), eraserSize);
+            // Top most first, later pens are stacked above earlier ones
+            for (auto i = remaining.count() - 1; i >= 0; i--) {
+                auto pen = remaining[i];
+                if (pen->sceneBoundingRect().intersects(rect) && pen->containsRect(position, eraserSize)) {
+                    remaining.removeAt(i);
+                    erased++;
+                    break;
+                }
+            }
+        }
+    });
+    report("Erase, linear scan", eraseScanTime, QString("%1 erased").arg(erased));
+
+    auto eraseIndexTime = bestOf(repetitions, fillIndex, [&]() {
+        erased = 0;
+        for (const auto& position : erasePositions) {
+            QRectF rect(position - QPointF(5, 5), eraserSize);
+            for (auto item : index.items(rect)) {
+                if (item->containsRect(position, eraserSize)) {
+                    index.removeItem(item);
+                    erased++;
+                    break;
+                }
+            }
+        }
+    });
+    report("Erase, PainterItemIndex", eraseIndexTime, QString("%1 erased").arg(erased));
+    fillIndex();
+
+    QList<QRectF> areas;
+    for (auto i = 0; i < 1000; i++) {
+        areas.append(QRectF(qrand() % 3440, qrand() % 1860, 400, 300));
+    }
+    auto isSelected = [](QGraphicsItem *item, const QRectF &area, const QPainterPath &path) {
+        return area.contains(item->sceneBoundingRect()) || path.contains(item->mapToScene(item->shape()));
+    };
+
+    auto selected = 0;
+    auto selectScanTime = bestOf(repetitions, [&]() {
+        selected = 0;
+        for (const auto& area : areas) {
+            QPainterPath path;
+            path.addRect(area);
+            for (auto pen : pens) {
+                if (pen->sceneBoundingRect().intersects(area) && isSelected(pen, area, path)) {
+                    selected++;
+                }
+            }
+        }
+    });
+    report("Selection area, linear scan", selectScanTime, QString("%1 selected").arg(selected));
+
+    auto selectIndexTime = bestOf(repetitions, [&]() {
+        selected = 0;
+        for (const auto& area : areas) {
+            QPainterPath path;
+            path.addRect(area);
+            for (auto item : index.items(area)) {
+                if (isSelected(item, area, path)) {
+                    selected++;
+                }
+            }
+        }
+    });
+    report("Selection area, PainterItemIndex", selectIndexTime, QString("%1 selected").arg(selected));
+
+    qDeleteAll(pens);
+}
+
+/*
+ * A long freehand stroke meandering over a 4K screenshot, drawn with and
+ * without merging points. Rendering is timed with the outline already cached,
+ * like repaints of a finished stroke.
+ */
+static void benchmarkPen(int repetitions)
+{
+    QList<QPointF> points;
+    qsrand(3);
+    QPointF position(100, 100);
+    auto direction = 1;
+    for (auto i = 0; i < 20000; i++) {
+        position += QPointF(direction * (1 + (qrand() % 100) / 100.0), (qrand() % 100) / 100.0 - 0.5);
+        if (position.x() < 100 || position.x() > 3740) {
+            direction = -direction;
+            position.ry() += 40;
+        }
+        points.append(position);
+    }
+
+    auto canvas = QImage(3840, 2160, QImage::Format_ARGB32_Premultiplied);
+    canvas.fill(Qt::white);
+    QStyleOptionGraphicsItem option;
+    for (auto tolerance : { 0.0, 0.5, 1.0 }) {
+        qint64 bytes = 0;
+        auto penTime = bestOf(repetitions, [&]() {
+            PainterPen pen(points.first(), QPen(Qt::red, 3), tolerance);
+            for (const auto& point : points) {
+                pen.addPoint(point);
+            }
+            pen.finish();
+            bytes = pen.byteCount();
+        });
+
+        PainterPen pen(points.first(), QPen(Qt::red, 3), tolerance);
+        for (const auto& point : points) {
+            pen.addPoint(point);
+        }
+        pen.finish();
+        report(QString("PainterPen, tolerance %1").arg(tolerance), penTime,
+               QString("%1 of %2 points kept, %3 bytes")
+               .arg(pen.storedPointCount())
+               .arg(pen.pointCount())
+               .arg(bytes));
+
+        auto item = static_cast<QGraphicsItem*>(&pen);
+        auto renderTime = bestOf(repetitions, [&]() {
+            QPainter painter(&canvas);
+            painter.setRenderHint(QPainter::Antialiasing);
+            item->paint(&painter, &option, nullptr);
+        });
+        report(QString("PainterPen, tolerance %1, render").arg(tolerance), renderTime);
+    }
+}
+
+/*
+ * Exposes the outline, so the stroke can be filled with color burn the way the
+ * marker painted before it cached the mask.
+ */
+class OutlineMarker : public PainterMarker
+{
+public:
+    OutlineMarker(const QPointF &pos, const QPen &attributes) : PainterMarker(pos, attributes)
+    {
+    }
+
+    const QPainterPath &outline()
+    {
+        return stroke();
+    }
+};
+
+static int maxChannelDifference(const QImage &image, const QImage &other, int *pixels)
+{
+    auto maximum = 0;
+    *pixels = 0;
+    for (auto y = 0; y < image.height(); y++) {
+        auto line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        auto otherLine = reinterpret_cast<const QRgb*>(other.constScanLine(y));
+        for (auto x = 0; x < image.width(); x++) {
+            auto difference = qMax(qMax(qAbs(qRed(line[x]) - qRed(otherLine[x])),
+                                        qAbs(qGreen(line[x]) - qGreen(otherLine[x]))),
+                                   qAbs(qBlue(line[x]) - qBlue(otherLine[x])));
+            if (difference > 0) {
+                (*pixels)++;
+            }
+            maximum = qMax(maximum, difference);
+        }
+    }
+    return maximum;
+}
+
+/*
+ * Color burns a long, self crossing stroke onto a screenshot by filling its
+ * outline and by the cached mask of the marker, and compares both results.
+ */
+static void benchmarkMarker(int repetitions)
+{
+    auto screenshot = createScreenshot(QSize(1920, 1080)).convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    QList<QPointF> points;
+    for (auto i = 0; i < 2000; i++) {
+        points.append(QPointF(960 + 800 * qSin(i / 150.0), 540 + 400 * qSin(i / 97.0)));
+    }
+
+    QStyleOptionGraphicsItem option;
+    for (const auto& color : { QColor(Qt::yellow), QColor(255, 165, 0), QColor(120, 200, 90) }) {
+        OutlineMarker marker(points.first(), QPen(color, 20));
+        for (const auto& point : points) {
+            marker.addPoint(point);
+        }
+        marker.finish();
+
+        QImage outlined;
+        auto outlineTime = bestOf(repetitions, [&]() {
+            outlined = screenshot.copy();
+            QPainter painter(&outlined);
+            painter.setRenderHint(QPainter::Antialiasing);
+            painter.setCompositionMode(QPainter::CompositionMode_ColorBurn);
+            painter.setPen(Qt::NoPen);
+            painter.setBrush(color);
+            painter.drawPath(marker.outline());
+        });
+        report(QString("Marker %1, outline").arg(color.name()), outlineTime);
+
+        // The first paint renders the mask, like the first paint on a scene.
+        QImage masked;
+        auto item = static_cast<QGraphicsItem*>(&marker);
+        auto paintMask = [&]() {
+            masked = screenshot.copy();
+            QPainter painter(&masked);
+            painter.setRenderHint(QPainter::Antialiasing);
+            item->paint(&painter, &option, nullptr);
+        };
+        QElapsedTimer timer;
+        timer.start();
+        paintMask();
+        report(QString("Marker %1, first mask").arg(color.name()), timer.nsecsElapsed());
+
+        auto maskTime = bestOf(repetitions, paintMask);
+        auto pixels = 0;
+        auto difference = maxChannelDifference(outlined, masked, &pixels);
+        report(QString("Marker %1, mask").arg(color.name()), maskTime,
+               QString("%1x, %2 pixels differ, at most by %3")
+               .arg(outlineTime / (double)qMax(maskTime, (qint64)1), 0, 'f', 1)
+               .arg(pixels)
+               .arg(difference));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    auto repetitions = qMax(1, app.arguments().value(1, "5").toInt());
+
+    benchmarkPng(repetitions);
+    benchmarkItemIndex(repetitions);
+    benchmarkPen(repetitions);
+    benchmarkMarker(repetitions);
+    return 0;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "BurstWriter.h"
+
+BurstWriter::BurstWriter(int capacity, QObject* parent) : QObject(parent),
+    mCapacity(qMax(capacity, 1)),
+    mIsFinishing(false),
+    mFrameCount(0),
+    mWrittenCount(0),
+    mFailedCount(0),
+    mDroppedCount(0),
+    mWatcher(new QFutureWatcher<void>(this))
+{
+    connect(mWatcher, &QFutureWatcher<void>::finished, this, &BurstWriter::finished);
+}
+
+/*
+ * Frames that are already queued are still written, same as the image saver
+ * we rather block than leave frames behind.
+ */
+BurstWriter::~BurstWriter()
+{
+    finish();
+    waitForFinished();
+}
+
+/*
+ * Starts the worker, frames are written next to the given path with the frame
+ * number appended to the file name.
+ */
+void BurstWriter::start(const QString& path)
+{
+    mPath = path;
+
+    // The config is not thread safe, so the encoder is set up here
+    mEncoder.setCompressionLevel(KsnipConfig::instance()->saveCompressionLevel());
+    mEncoder.setThreadCount(KsnipConfig::instance()->saveThreadCount());
+
+    mWatcher->setFuture(QtConcurrent::run(this, &BurstWriter::writeFrames));
+}
+
+/*
+ * Never blocks on the writer, returns false when all slots are taken and the
+ * frame was dropped. Frames from the shared memory grabber keep their segment
+ * until they are written, so the slots also bound the captured memory.
+ */
+bool BurstWriter::enqueue(const QImage& frame)
+{
+    QMutexLocker locker(&mMutex);
+    auto index = mFrameCount++;
+    if (mFrames.count() >= mCapacity) {
+        mDroppedCount++;
+        return false;
+    }
+
+    mFrames.enqueue({ frame, index });
+    mFrameAvailable.wakeOne();
+    return true;
+}
+
+/*
+ * No more frames follow, the worker writes what is queued and stops. The
+ * finished signal is emitted once the last frame was written.
+ */
+void BurstWriter::finish()
+{
+    QMutexLocker locker(&mMutex);
+    mIsFinishing = true;
+    mFrameAvailable.wakeAll();
+}
+
+void BurstWriter::waitForFinished()
+{
+    mWatcher->waitForFinished();
+}
+
+int BurstWriter::frameCount() const
+{
+    QMutexLocker locker(&mMutex);
+    return mFrameCount;
+}
+
+int BurstWriter::writtenCount() const
+{
+    QMutexLocker locker(&mMutex);
+    return mWrittenCount;
+}
+
+int BurstWriter::failedCount() const
+{
+    QMutexLocker locker(&mMutex);
+    return mFailedCount;
+}
+
+int BurstWriter::droppedCount() const
+{
+    QMutexLocker locker(&mMutex);
+    return mDroppedCount;
+}
+
+//
+// Private Functions
+//
+
+/*
+ * Runs on the worker thread until finish was called and the queue is empty.
+ */
+void BurstWriter::writeFrames()
+{
+    forever {
+        Frame frame;
+        {
+            QMutexLocker locker(&mMutex);
+            while (mFrames.isEmpty() && !mIsFinishing) {
+                mFrameAvailable.wait(&mMutex);
+            }
+            if (mFrames.isEmpty()) {
+                return;
+            }
+            frame = mFrames.dequeue();
+        }
+
+        auto success = ImageSaver::writeImage(frame.image, framePath(frame.index), mEncoder);
+
+        // Release the frame before taking the lock, a shared memory segment
+        // goes back to the grabber's pool right away.
+        frame.image = QImage();
+
+        QMutexLocker locker(&mMutex);
+        if (success) {
+            mWrittenCount++;
+        } else {
+            mFailedCount++;
+        }
+    }
+}
+
+QString BurstWriter::framePath(int index) const
+{
+    QFileInfo fileInfo(mPath);
+    auto filename = fileInfo.completeBaseName()
+                    + QStringLiteral("_%1").arg(index + 1, 4, 10, QLatin1Char('0'));
+    if (!fileInfo.suffix().isEmpty()) {
+        filename += "." + fileInfo.suffix();
+    }
+    return fileInfo.dir().filePath(filename);
+}
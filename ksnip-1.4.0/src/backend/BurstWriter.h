@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef BURSTWRITER_H
+#define BURSTWRITER_H
+
+#include <QObject>
+#include <QImage>
+#include <QQueue>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <QFileInfo>
+#include <QDir>
+
+#include "ImageSaver.h"
+#include "KsnipConfig.h"
+
+/*
+ * Writes the frames of an interval capture on a worker thread. Frames wait in
+ * a queue with a fixed number of slots, when the writer falls behind new
+ * frames are dropped instead of blocking the capture.
+ */
+class BurstWriter : public QObject
+{
+    Q_OBJECT
+public:
+    BurstWriter(int capacity, QObject *parent = 0);
+    ~BurstWriter();
+    void start(const QString &path);
+    bool enqueue(const QImage &frame);
+    void finish();
+    void waitForFinished();
+    int frameCount() const;
+    int writtenCount() const;
+    int failedCount() const;
+    int droppedCount() const;
+
+signals:
+    void finished() const;
+
+private:
+    struct Frame {
+        QImage image;
+        int    index;
+    };
+
+    QQueue<Frame>         mFrames;
+    int                   mCapacity;
+    bool                  mIsFinishing;
+    int                   mFrameCount;
+    int                   mWrittenCount;
+    int                   mFailedCount;
+    int                   mDroppedCount;
+    QString               mPath;
+    PngEncoder            mEncoder;
+    QFutureWatcher<void> *mWatcher;
+    mutable QMutex        mMutex;
+    QWaitCondition        mFrameAvailable;
+
+    void writeFrames();
+    QString framePath(int index) const;
+};
+
+#endif // BURSTWRITER_H
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "CaptureClient.h"
+
+CaptureClient::CaptureClient() :
+    mSocket(nullptr),
+    mDescriptor(-1)
+{
+}
+
+CaptureClient::~CaptureClient()
+{
+    if (mSocket) {
+        delete mSocket;
+    } else if (mDescriptor >= 0) {
+        ::close(mDescriptor);
+    }
+}
+
+/*
+ * Returns false when no daemon is running, the caller then captures in
+ * process. Connects with a plain socket to the path QLocalServer listens on,
+ * so it works before any application object exists and a run without daemon
+ * doesn't have to create one. A daemon of another user is never trusted.
+ */
+bool CaptureClient::connectToDaemon()
+{
+    auto path = QFile::encodeName(CaptureServer::serverName());
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    if (path.isEmpty() || path.size() >= (int)sizeof(address.sun_path)) {
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.constData(), path.size());
+
+    mDescriptor = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (mDescriptor < 0) {
+        return false;
+    }
+
+    if (::connect(mDescriptor, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(mDescriptor);
+        mDescriptor = -1;
+        return false;
+    }
+
+    if (!CaptureServer::isOwnUser(mDescriptor)) {
+        qWarning("CaptureClient::connectToDaemon: Daemon socket is served by another user, ignoring it.");
+        ::close(mDescriptor);
+        mDescriptor = -1;
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Sends the request and waits for the reply. The daemon closes the connection
+ * after replying, a rect area capture waits for the user, so there is no
+ * timeout while waiting. Requires an application object.
+ */
+bool CaptureClient::capture(const CaptureServer::Request& request)
+{
+    if (mDescriptor < 0) {
+        return false;
+    }
+
+    mSocket = new QLocalSocket;
+    mSocket->setSocketDescriptor(mDescriptor);
+    mSocket->write(CaptureServer::encodeRequest(request));
+    if (!mSocket->waitForBytesWritten(mConnectTimeout)) {
+        qWarning("CaptureClient::capture: Unable to send request to daemon: %s",
+                 qPrintable(mSocket->errorString()));
+        return false;
+    }
+
+    QByteArray reply;
+    while (mSocket->state() == QLocalSocket::ConnectedState && mSocket->waitForReadyRead(-1)) {
+        reply.append(mSocket->readAll());
+    }
+    reply.append(mSocket->readAll());
+
+    QDataStream stream(reply);
+    stream.setVersion(QDataStream::Qt_5_4);
+    bool success = false;
+    stream >> success >> mPath;
+
+    if (stream.status() != QDataStream::Ok) {
+        qWarning("CaptureClient::capture: Daemon closed the connection without reply.");
+        return false;
+    }
+    return success;
+}
+
+QString CaptureClient::path() const
+{
+    return mPath;
+}
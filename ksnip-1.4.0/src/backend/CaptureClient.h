@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CAPTURECLIENT_H
+#define CAPTURECLIENT_H
+
+#include <QLocalSocket>
+#include <QFile>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "CaptureServer.h"
+
+/*
+ * Forwards a capture request to a running ksnip daemon and blocks until the
+ * daemon has written the capture.
+ */
+class CaptureClient
+{
+public:
+    CaptureClient();
+    ~CaptureClient();
+    bool connectToDaemon();
+    bool capture(const CaptureServer::Request &request);
+    QString path() const;
+
+private:
+    QLocalSocket *mSocket;
+    int           mDescriptor;
+    QString       mPath;
+    const int     mConnectTimeout = 200;
+};
+
+#endif // CAPTURECLIENT_H
@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "CaptureServer.h"
+
+Q_LOGGING_CATEGORY(ksnipDaemon, "ksnip.daemon", QtWarningMsg)
+
+CaptureServer::CaptureServer(QObject* parent) : QObject(parent),
+    mServer(new QLocalServer(this)),
+    mIsCapturing(false)
+{
+    connect(mServer, &QLocalServer::newConnection, this, &CaptureServer::newConnection);
+}
+
+CaptureServer::~CaptureServer()
+{
+    mServer->close();
+}
+
+/*
+ * Starts listening for capture requests. When the socket of a crashed daemon
+ * is still lying around it gets removed, when another daemon is answering
+ * we don't take over. The socket is only accessible by the current user.
+ */
+bool CaptureServer::listen()
+{
+    if (serverName().isEmpty()) {
+        qWarning("CaptureServer::listen: No private directory for the daemon socket.");
+        return false;
+    }
+
+    mServer->setSocketOptions(QLocalServer::UserAccessOption);
+    if (mServer->listen(serverName())) {
+        return true;
+    }
+
+    QLocalSocket probe;
+    probe.connectToServer(serverName());
+    if (probe.waitForConnected(500)) {
+        qWarning("CaptureServer::listen: Another ksnip daemon is already running.");
+        return false;
+    }
+
+    QLocalServer::removeServer(serverName());
+    if (!mServer->listen(serverName())) {
+        qWarning("CaptureServer::listen: Unable to listen on '%s': %s",
+                 qPrintable(serverName()),
+                 qPrintable(mServer->errorString()));
+        return false;
+    }
+    return true;
+}
+
+/*
+ * The server is per user, different users on the same machine each need their
+ * own daemon as the captures are written with their permissions. The socket
+ * lives in a directory only the user can access, so no other user can place
+ * a socket there. Returns an empty path if there is no such directory.
+ */
+QString CaptureServer::serverName()
+{
+    auto directory = socketDirectory();
+    if (directory.isEmpty()) {
+        return QString();
+    }
+    return directory + QStringLiteral("/ksnip.socket");
+}
+
+/*
+ * Checks that the other end of a connected socket runs as the current user.
+ */
+bool CaptureServer::isOwnUser(int descriptor)
+{
+#ifdef SO_PEERCRED
+    ucred credentials;
+    socklen_t size = sizeof(credentials);
+    if (::getsockopt(descriptor, SOL_SOCKET, SO_PEERCRED, &credentials, &size) != 0) {
+        return false;
+    }
+    return credentials.uid == ::getuid();
+#else
+    uid_t uid;
+    gid_t gid;
+    if (::getpeereid(descriptor, &uid, &gid) != 0) {
+        return false;
+    }
+    return uid == ::getuid();
+#endif
+}
+
+QByteArray CaptureServer::encodeRequest(const Request& request)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_4);
+    stream << (qint32)request.captureMode << request.captureCursor << (qint32)request.delay;
+    return data;
+}
+
+bool CaptureServer::decodeRequest(const QByteArray& data, Request* request)
+{
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_4);
+    qint32 captureMode;
+    qint32 delay;
+    stream >> captureMode >> request->captureCursor >> delay;
+
+    if (stream.status() != QDataStream::Ok ||
+            captureMode < ImageGrabber::RectArea ||
+            captureMode > ImageGrabber::ActiveWindow ||
+            delay < 0) {
+        return false;
+    }
+    request->captureMode = (ImageGrabber::CaptureMode)captureMode;
+    request->delay = delay;
+    return true;
+}
+
+/*
+ * Requests have a fixed size, so the server knows when it has received the
+ * whole request without further framing.
+ */
+int CaptureServer::requestSize()
+{
+    return sizeof(qint32) + sizeof(quint8) + sizeof(qint32);
+}
+
+//
+// Public Slots
+//
+
+/*
+ * Called once the capture of the current request was written or canceled, an
+ * empty path means nothing was written. The reply is sent and the connection
+ * closed, which tells the client that the reply is complete.
+ */
+void CaptureServer::captureFinished(const QString& path, bool success)
+{
+    if (!mIsCapturing) {
+        return;
+    }
+
+    mPendingRequests.dequeue();
+    auto client = mPendingClients.dequeue();
+
+    qCDebug(ksnipDaemon, "Served capture request to '%s' in %lld ms",
+            qPrintable(path), mRequestTimer.elapsed());
+
+    if (client) {
+        QByteArray reply;
+        QDataStream stream(&reply, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_4);
+        stream << success << path;
+        client->write(reply);
+        client->disconnectFromServer();
+    }
+    mIsCapturing = false;
+
+    startNextRequest();
+}
+
+//
+// Private Functions
+//
+
+void CaptureServer::startNextRequest()
+{
+    if (mIsCapturing || mPendingRequests.isEmpty()) {
+        return;
+    }
+
+    mIsCapturing = true;
+    auto request = mPendingRequests.head();
+    mRequestTimer.start();
+    emit captureRequested(request.captureMode, request.captureCursor, request.delay);
+}
+
+/*
+ * Prefers the runtime directory of the session, which is private to the user
+ * by definition. Otherwise a directory named after the user id is created in
+ * the temp directory, one that already exists is only used when it belongs to
+ * the user and nobody else can access it.
+ */
+QString CaptureServer::socketDirectory()
+{
+    auto runtimeDirectory = QFile::decodeName(qgetenv("XDG_RUNTIME_DIR"));
+    if (!runtimeDirectory.isEmpty() && isPrivateDirectory(runtimeDirectory)) {
+        return QDir::cleanPath(runtimeDirectory);
+    }
+
+    auto directory = QDir::cleanPath(QDir::tempPath()) + QStringLiteral("/ksnip-") + QString::number(::getuid());
+    ::mkdir(QFile::encodeName(directory).constData(), 0700);
+    if (!isPrivateDirectory(directory)) {
+        return QString();
+    }
+    return directory;
+}
+
+/*
+ * Symbolic links are not followed, someone else could point them anywhere.
+ */
+bool CaptureServer::isPrivateDirectory(const QString& path)
+{
+    struct stat info;
+    if (::lstat(QFile::encodeName(path).constData(), &info) != 0) {
+        return false;
+    }
+    return S_ISDIR(info.st_mode) && info.st_uid == ::getuid() && (info.st_mode & 077) == 0;
+}
+
+//
+// Private Slots
+//
+
+void CaptureServer::newConnection()
+{
+    while (mServer->hasPendingConnections()) {
+        auto socket = mServer->nextPendingConnection();
+        if (!isOwnUser(socket->socketDescriptor())) {
+            qWarning("CaptureServer::newConnection: Rejected connection of another user.");
+            socket->abort();
+            socket->deleteLater();
+            continue;
+        }
+        connect(socket, &QLocalSocket::readyRead, [this, socket]() {
+            readRequest(socket);
+        });
+        connect(socket, &QLocalSocket::disconnected, [this, socket]() {
+            clientDisconnected(socket);
+        });
+        connect(socket, &QLocalSocket::disconnected, socket, &QLocalSocket::deleteLater);
+    }
+}
+
+void CaptureServer::readRequest(QLocalSocket* socket)
+{
+    if (socket->bytesAvailable() < requestSize()) {
+        return;
+    }
+
+    Request request;
+    if (!decodeRequest(socket->read(requestSize()), &request)) {
+        qWarning("CaptureServer::readRequest: Received invalid capture request.");
+        socket->disconnectFromServer();
+        return;
+    }
+
+    mPendingClients.enqueue(socket);
+    mPendingRequests.enqueue(request);
+    startNextRequest();
+}
+
+/*
+ * A client that went away doesn't get a reply, but a capture that is already
+ * running is finished anyway. Requests that haven't started are dropped.
+ */
+void CaptureServer::clientDisconnected(QLocalSocket* socket)
+{
+    for (auto i = mPendingClients.count() - 1; i >= 0; i--) {
+        if (mPendingClients[i] != socket) {
+            continue;
+        }
+        if (i == 0 && mIsCapturing) {
+            mPendingClients[i] = nullptr;
+        } else {
+            mPendingClients.removeAt(i);
+            mPendingRequests.removeAt(i);
+        }
+    }
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CAPTURESERVER_H
+#define CAPTURESERVER_H
+
+#include <QObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QDataStream>
+#include <QQueue>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <QDir>
+#include <QFile>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ImageGrabber.h"
+
+Q_DECLARE_LOGGING_CATEGORY(ksnipDaemon)
+
+/*
+ * Accepts capture requests from other ksnip instances when ksnip runs as
+ * resident daemon. Requests are handled one after another, the client gets
+ * the path of the written file as reply.
+ */
+class CaptureServer : public QObject
+{
+    Q_OBJECT
+public:
+    struct Request {
+        ImageGrabber::CaptureMode captureMode;
+        bool captureCursor;
+        int delay;
+    };
+
+public:
+    CaptureServer(QObject *parent = 0);
+    ~CaptureServer();
+    bool listen();
+    static QString serverName();
+    static bool isOwnUser(int descriptor);
+    static QByteArray encodeRequest(const Request &request);
+    static bool decodeRequest(const QByteArray &data, Request *request);
+    static int requestSize();
+
+public slots:
+    void captureFinished(const QString &path, bool success);
+
+signals:
+    void captureRequested(ImageGrabber::CaptureMode captureMode,
+                          bool captureCursor,
+                          int delay) const;
+
+private:
+    QLocalServer          *mServer;
+    QQueue<QLocalSocket*>  mPendingClients;
+    QQueue<Request>        mPendingRequests;
+    bool                   mIsCapturing;
+    QElapsedTimer          mRequestTimer;
+
+    void startNextRequest();
+    static QString socketDirectory();
+    static bool isPrivateDirectory(const QString &path);
+
+private slots:
+    void newConnection();
+    void readRequest(QLocalSocket *socket);
+    void clientDisconnected(QLocalSocket *socket);
+};
+
+#endif // CAPTURESERVER_H
@@ -24,14 +24,39 @@
 #include "src/gui/SnippingArea.h"
 #include "src/helper/X11GraphicsHelper.h"
 
+// Capture timings are logged when enabled with
+// QT_LOGGING_RULES="ksnip.capture.debug=true"
+Q_LOGGING_CATEGORY(ksnipCapture, "ksnip.capture", QtWarningMsg)
+
 ImageGrabber::ImageGrabber(MainWindow* parent) : QObject(), mParent(parent)
 {
     mSnippingArea = nullptr;
+    mShmGrabber = new X11ShmGrabber();
+    mIsBurst = false;
+    mBurstInterval = 1;
+    mBurstFrameCount = 0;
+    mBurstTick = 0;
+    mBurstMissedFrames = 0;
+    mBurstTimer = new QTimer(this);
+    mBurstTimer->setSingleShot(true);
+    mBurstTimer->setTimerType(Qt::PreciseTimer);
+    connect(mBurstTimer, &QTimer::timeout, this, &ImageGrabber::grabBurstFrame);
+    mIsWatch = false;
+    mDamageWatcher = nullptr;
+    mWatchTimer = new QTimer(this);
+    mWatchTimer->setSingleShot(true);
+    connect(mWatchTimer, &QTimer::timeout, this, &ImageGrabber::grabChangedFrame);
+    mIsScroll = false;
+    mStitcher = nullptr;
+    mScrollTimer = new QTimer(this);
+    connect(mScrollTimer, &QTimer::timeout, this, &ImageGrabber::grabScrollFrame);
 }
 
 ImageGrabber::~ImageGrabber()
 {
     delete mSnippingArea;
+    delete mShmGrabber;
+    delete mStitcher;
 }
 
 //
@@ -40,9 +65,16 @@ ImageGrabber::~ImageGrabber()
 
 void ImageGrabber::grabImage(CaptureMode captureMode, bool capureCursor, int delay)
 {
+    mIsBurst = false;
+    mIsWatch = false;
+    mIsScroll = false;
+    mBurstTick = 0;
+    mBurstMissedFrames = 0;
+    mBurstClock.start();
     mCaptureCursor = capureCursor;
     mCaptureDelay = (delay < 0) ? 0 : delay;
     mCaptureMode = captureMode;
+    mShmGrabber->setPoolLimit((qint64)KsnipConfig::instance()->captureBufferPoolSize() * 1024 * 1024);
 
     if (mCaptureMode == RectArea) {
         openSnippingArea();
@@ -51,11 +83,104 @@ void ImageGrabber::grabImage(CaptureMode captureMode, bool capureCursor, int del
     }
 }
 
+/*
+ * Captures a frame every interval msec until frameCount intervals have passed
+ * or stopBurst is called, zero frames captures until stopped. After the delay,
+ * or once a rect area was selected, the frames are emitted via frameGrabbed,
+ * as images so buffers of the shared memory grabber are reused once a frame
+ * was released.
+ */
+void ImageGrabber::grabBurst(CaptureMode captureMode,
+                             bool captureCursor,
+                             int delay,
+                             int interval,
+                             int frameCount)
+{
+    grabImage(captureMode, captureCursor, delay);
+    mIsBurst = true;
+    mBurstInterval = qMax(interval, 1);
+    mBurstFrameCount = qMax(frameCount, 0);
+}
+
+/*
+ * Captures a frame whenever the watched area has changed enough, instead of
+ * on fixed intervals. The root window is watched, or the active window in
+ * ActiveWindow mode. Changes are collected via XDamage and only the changed
+ * parts are grabbed again and merged into the previous frame. Frames are
+ * emitted via frameGrabbed like for grabBurst.
+ */
+void ImageGrabber::grabWatch(CaptureMode captureMode,
+                             bool captureCursor,
+                             int delay,
+                             int frameCount)
+{
+    grabImage(captureMode, captureCursor, delay);
+    mIsWatch = true;
+    mBurstFrameCount = qMax(frameCount, 0);
+}
+
+/*
+ * Grabs the active window repeatedly while the user scrolls it and stitches
+ * the frames into one tall image, which is emitted via scrollFinished once the
+ * content stopped moving for a while or stopBurst was called.
+ */
+void ImageGrabber::grabScroll(int delay)
+{
+    grabImage(ActiveWindow, false, delay);
+    mIsScroll = true;
+}
+
+/*
+ * Stops an interval, watching or scrolling capture.
+ */
+void ImageGrabber::stopBurst()
+{
+    if (mIsScroll) {
+        mIsScroll = false;
+        mScrollTimer->stop();
+        auto image = mStitcher ? mStitcher->result() : QImage();
+        delete mStitcher;
+        mStitcher = nullptr;
+        qCDebug(ksnipCapture, "Scroll capture stitched to %dx%d in %lld ms",
+                image.width(), image.height(), mBurstClock.elapsed());
+        emit scrollFinished(image);
+        return;
+    }
+
+    if (mIsWatch) {
+        mIsWatch = false;
+        mWatchTimer->stop();
+        // Stopping during the delay, the watcher is only created once the
+        // first frame was grabbed.
+        if (mDamageWatcher) {
+            mDamageWatcher->stop();
+        }
+        mWatchFrame = QImage();
+        mWatchDamage = QRegion();
+        qCDebug(ksnipCapture, "Watch stopped after %d frames in %lld ms",
+                mBurstTick, mBurstClock.elapsed());
+        emit burstFinished(0);
+        return;
+    }
+
+    if (!mIsBurst) {
+        return;
+    }
+
+    mIsBurst = false;
+    mBurstTimer->stop();
+    qCDebug(ksnipCapture, "Burst stopped after %d intervals in %lld ms, %d frames missed",
+            mBurstTick, mBurstClock.elapsed(), mBurstMissedFrames);
+    emit burstFinished(mBurstMissedFrames);
+}
+
 void ImageGrabber::openSnippingArea()
 {
     initSnippingAreaIfRequired();
 
-    if (X11GraphicsHelper::isCompositorActive()) {
+    // The compositor state is tracked by the watcher, no round trip to the X
+    // server is required here.
+    if (X11CompositorWatcher::instance()->isCompositorActive()) {
         mSnippingArea->showWithoutBackground();
     } else {
         auto screenRect = X11GraphicsHelper::getFullScreenRect();
@@ -118,8 +243,28 @@ QRect ImageGrabber::currectScreenRect() const
 
 void ImageGrabber::grabRect()
 {
+    if (mIsBurst) {
+        startBurst();
+        return;
+    }
+
+    if (mIsWatch) {
+        startWatch();
+        return;
+    }
+
+    if (mIsScroll) {
+        startScroll();
+        return;
+    }
+
     setRectFromCorrectSource();
-    auto screenShot = createPixmap(mCaptureRect);
+    QPixmap screenShot;
+    if (mCaptureMode == FullScreen) {
+        screenShot = QPixmap::fromImage(createFullScreenImage(mCaptureRect));
+    } else {
+        screenShot = createPixmap(mCaptureRect);
+    }
 
     if (mCaptureCursor) {
         screenShot = X11GraphicsHelper::blendCursorImage(screenShot, mCaptureRect);
@@ -127,13 +272,348 @@ void ImageGrabber::grabRect()
     emit finished(screenShot);
 }
 
+/*
+ * Grabs via MIT-SHM when the X server supports it, which avoids copying every
+ * pixel over the X connection, otherwise through QScreen::grabWindow.
+ */
 QPixmap ImageGrabber::createPixmap(const QRect& rect) const
 {
-    auto screen = QGuiApplication::primaryScreen();
-    auto pixmap = screen->grabWindow(QApplication::desktop()->winId(),
-                                            rect.topLeft().x(),
-                                            rect.topLeft().y(),
-                                            rect.width(),
-                                            rect.height());
+    QElapsedTimer timer;
+    timer.start();
+
+    auto image = mShmGrabber->grabRect(rect);
+    if (!image.isNull()) {
+        auto pixmap = QPixmap::fromImage(std::move(image));
+        qCDebug(ksnipCapture, "Grabbed %dx%d via MIT-SHM in %lld ms",
+                rect.width(), rect.height(), timer.elapsed());
+        return pixmap;
+    }
+
+    auto pixmap = grabScreenRect(rect);
+    qCDebug(ksnipCapture, "Grabbed %dx%d via QScreen::grabWindow in %lld ms",
+            rect.width(), rect.height(), timer.elapsed());
     return pixmap;
 }
+
+QPixmap ImageGrabber::grabScreenRect(const QRect& rect) const
+{
+    auto screen = QGuiApplication::primaryScreen();
+    return screen->grabWindow(QApplication::desktop()->winId(),
+                              rect.topLeft().x(),
+                              rect.topLeft().y(),
+                              rect.width(),
+                              rect.height());
+}
+
+/*
+ * Same as createPixmap but keeps the frame as image, which wraps the shared
+ * memory segment without copying it. The segment is reused by a later grab
+ * once the image was released.
+ */
+QImage ImageGrabber::createImage(const QRect& rect) const
+{
+    auto image = mShmGrabber->grabRect(rect);
+    if (!image.isNull()) {
+        return image;
+    }
+    return createPixmap(rect).toImage();
+}
+
+/*
+ * Grabs every monitor on its own and concurrently, areas of the root window
+ * that are not covered by any monitor stay transparent instead of being
+ * grabbed and transferred. With a single monitor, or without MIT-SHM, the
+ * whole rect is grabbed at once.
+ */
+QImage ImageGrabber::createFullScreenImage(const QRect& rect) const
+{
+    auto screens = QGuiApplication::screens();
+    if (screens.count() < 2 || !mShmGrabber->isAvailable()) {
+        return createImage(rect);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Monitors outside of the rect, if any, are left out
+    QList<QRect> geometries;
+    QStringList names;
+    for (auto screen : screens) {
+        auto geometry = screen->geometry() & rect;
+        if (!geometry.isEmpty()) {
+            geometries.append(geometry);
+            names.append(screen->name());
+        }
+    }
+
+    QList<QFuture<QImage>> grabs;
+    for (auto i = 0; i < geometries.count(); i++) {
+        auto geometry = geometries[i];
+        auto name = names[i];
+        grabs.append(QtConcurrent::run([this, geometry, name]() {
+            QElapsedTimer screenTimer;
+            screenTimer.start();
+            auto image = mShmGrabber->grabRect(geometry);
+            qCDebug(ksnipCapture, "Grabbed screen %s with %dx%d in %lld ms",
+                    qPrintable(name), geometry.width(), geometry.height(), screenTimer.elapsed());
+            return image;
+        }));
+    }
+
+    QImage fullScreen(rect.size(), QImage::Format_ARGB32_Premultiplied);
+    fullScreen.fill(Qt::transparent);
+    QPainter painter(&fullScreen);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    for (auto i = 0; i < grabs.count(); i++) {
+        auto image = grabs[i].result();
+        if (image.isNull()) {
+            painter.end();
+            qCDebug(ksnipCapture, "Grabbing screen %s failed, grabbing full screen at once",
+                    qPrintable(names[i]));
+            return createImage(rect);
+        }
+        painter.drawImage(geometries[i].topLeft() - rect.topLeft(), image);
+    }
+    painter.end();
+
+    qCDebug(ksnipCapture, "Grabbed and assembled %d screens in %lld ms",
+            grabs.count(), timer.elapsed());
+    return fullScreen;
+}
+
+/*
+ * The first frame is taken right away, every following one is scheduled for
+ * its tick relative to the start so timer latency doesn't add up over time.
+ */
+void ImageGrabber::startBurst()
+{
+    mBurstTick = 0;
+    mBurstMissedFrames = 0;
+    mBurstClock.start();
+    grabBurstFrame();
+}
+
+/*
+ * When grabbing or the event loop fell behind and ticks have passed without a
+ * frame, those ticks are counted as missed frames and skipped instead of
+ * being caught up, so the cadence stays the same.
+ */
+void ImageGrabber::grabBurstFrame()
+{
+    if (!mIsBurst) {
+        return;
+    }
+
+    auto tick = (int)((mBurstClock.elapsed() + mBurstInterval / 2) / mBurstInterval);
+    if (tick > mBurstTick) {
+        mBurstMissedFrames += tick - mBurstTick;
+    }
+    mBurstTick = qMax(tick, mBurstTick);
+
+    if (mBurstFrameCount > 0 && mBurstTick >= mBurstFrameCount) {
+        mBurstMissedFrames -= mBurstTick - mBurstFrameCount;
+        mBurstTick = mBurstFrameCount;
+        stopBurst();
+        return;
+    }
+
+    setRectFromCorrectSource();
+    auto frame = (mCaptureMode == FullScreen) ? createFullScreenImage(mCaptureRect) : createImage(mCaptureRect);
+    if (mCaptureCursor) {
+        X11GraphicsHelper::blendCursorImage(&frame, mCaptureRect);
+    }
+    emit frameGrabbed(frame);
+
+    mBurstTick++;
+    if (mBurstFrameCount > 0 && mBurstTick >= mBurstFrameCount) {
+        stopBurst();
+        return;
+    }
+
+    auto nextFrame = (qint64)mBurstTick * mBurstInterval - mBurstClock.elapsed();
+    mBurstTimer->start(qMax(nextFrame, (qint64)0));
+}
+
+/*
+ * Takes the first frame in full, every following frame only grabs what has
+ * changed since. The frame is a copy so it doesn't keep a shared memory
+ * segment of the grabber.
+ */
+void ImageGrabber::startWatch()
+{
+    if (!mDamageWatcher) {
+        mDamageWatcher = new X11DamageWatcher(this);
+        connect(mDamageWatcher, &X11DamageWatcher::damaged, this, &ImageGrabber::addDamage);
+    }
+
+    setRectFromCorrectSource();
+
+    auto window = QX11Info::appRootWindow();
+    mWatchOffset = QPoint();
+    if (mCaptureMode == ActiveWindow) {
+        auto windowId = X11GraphicsHelper::getActiveWindowId();
+        if (windowId) {
+            window = windowId;
+            mWatchOffset = X11GraphicsHelper::getWindowRect(windowId).topLeft();
+        }
+    }
+
+    if (!mDamageWatcher->watch(window)) {
+        qWarning("ImageGrabber::startWatch: XDamage not available, capturing every second instead.");
+        mIsWatch = false;
+        mIsBurst = true;
+        mBurstInterval = 1000;
+        startBurst();
+        return;
+    }
+
+    auto threshold = qBound(0, KsnipConfig::instance()->watchChangeThreshold(), 100);
+    mWatchMinArea = qMax((qint64)mCaptureRect.width() * mCaptureRect.height() * threshold / 100, (qint64)1);
+    mWatchDamage = QRegion();
+    mWatchFrame = createImage(mCaptureRect).copy();
+    mBurstTick = 0;
+    mBurstClock.start();
+    emitWatchFrame();
+}
+
+/*
+ * The cursor is painted into the watched frame itself and the pixels it
+ * covered are put back afterwards, only the small area below the cursor is
+ * copied and the frame stays free of the cursor for the next damage.
+ */
+void ImageGrabber::emitWatchFrame()
+{
+    if (mCaptureCursor) {
+        QPoint cursorPos;
+        auto cursorImage = X11GraphicsHelper::getCursorImage(mCaptureRect, &cursorPos);
+        auto cursorRect = QRect(cursorPos, cursorImage.size()) & mWatchFrame.rect();
+        if (cursorRect.isEmpty()) {
+            emit frameGrabbed(mWatchFrame);
+        } else {
+            auto covered = mWatchFrame.copy(cursorRect);
+            QPainter painter(&mWatchFrame);
+            painter.drawImage(cursorPos, cursorImage);
+            painter.end();
+            emit frameGrabbed(mWatchFrame);
+            painter.begin(&mWatchFrame);
+            painter.setCompositionMode(QPainter::CompositionMode_Source);
+            painter.drawImage(cursorRect.topLeft(), covered);
+        }
+    } else {
+        emit frameGrabbed(mWatchFrame);
+    }
+
+    mBurstTick++;
+    if (mBurstFrameCount > 0 && mBurstTick >= mBurstFrameCount) {
+        stopBurst();
+    }
+}
+
+qint64 ImageGrabber::area(const QRegion& region) const
+{
+    qint64 area = 0;
+    for (const auto& rect : region.rects()) {
+        area += (qint64)rect.width() * rect.height();
+    }
+    return area;
+}
+
+/*
+ * Damage arrives in many small events, they are collected for a short moment
+ * before we check whether enough has changed.
+ */
+void ImageGrabber::addDamage(const QRect& area)
+{
+    if (!mIsWatch) {
+        return;
+    }
+
+    mWatchDamage += area.translated(mWatchOffset) & mCaptureRect;
+    if (!mWatchTimer->isActive()) {
+        mWatchTimer->start(mWatchCoalesceDelay);
+    }
+}
+
+/*
+ * Changes below the threshold are kept and add up with later ones. Regions
+ * made of many small rects are grabbed as one bounding rect, grabbing each of
+ * them would cost a round trip per rect.
+ */
+void ImageGrabber::grabChangedFrame()
+{
+    if (!mIsWatch) {
+        return;
+    }
+
+    auto changedArea = area(mWatchDamage);
+    if (changedArea < mWatchMinArea) {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Changes made from now on are reported again.
+    mDamageWatcher->reset();
+
+    auto rects = mWatchDamage.rects();
+    if (rects.count() > mMaxDamageRects) {
+        rects = { mWatchDamage.boundingRect() };
+    }
+
+    // The shared memory pool keeps buffers by exact size, grabbing every
+    // changed rect through it would attach a new segment for every size. Large
+    // changes grab the whole area, which always reuses the same buffer, small
+    // ones are fetched directly.
+    QPainter painter(&mWatchFrame);
+    if (changedArea * mWatchFullGrabRatio >= (qint64)mCaptureRect.width() * mCaptureRect.height()) {
+        rects = { mCaptureRect };
+        painter.drawImage(0, 0, createImage(mCaptureRect));
+    } else {
+        for (const auto& rect : rects) {
+            painter.drawPixmap(rect.topLeft() - mCaptureRect.topLeft(), grabScreenRect(rect));
+        }
+    }
+    painter.end();
+    mWatchDamage = QRegion();
+
+    qCDebug(ksnipCapture, "Merged %d changed rects with %lld pixels into frame in %lld ms",
+            rects.count(), changedArea, timer.elapsed());
+    emitWatchFrame();
+}
+
+/*
+ * The window rect is taken once, the window must not be moved or resized
+ * while it is scrolled.
+ */
+void ImageGrabber::startScroll()
+{
+    setRectFromCorrectSource();
+    delete mStitcher;
+    mStitcher = new ScrollStitcher();
+    mScrollIdleTime = 0;
+    mBurstClock.start();
+    grabScrollFrame();
+    mScrollTimer->start(mScrollInterval);
+}
+
+void ImageGrabber::grabScrollFrame()
+{
+    if (!mIsScroll) {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (mStitcher->addFrame(createImage(mCaptureRect))) {
+        mScrollIdleTime = 0;
+        qCDebug(ksnipCapture, "Stitched scrolled frame in %lld ms", timer.elapsed());
+    } else {
+        mScrollIdleTime += mScrollInterval;
+    }
+
+    if (mScrollIdleTime >= mMaxScrollIdleTime) {
+        stopBurst();
+    }
+}
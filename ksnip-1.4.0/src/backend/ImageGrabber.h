@@ -24,6 +24,17 @@
 #include <QObject>
 #include <QPainter>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <QtConcurrent>
+#include <QScreen>
+
+#include "X11ShmGrabber.h"
+#include "ScrollStitcher.h"
+#include "src/helper/X11DamageWatcher.h"
+#include "src/helper/X11CompositorWatcher.h"
+
+Q_DECLARE_LOGGING_CATEGORY(ksnipCapture)
 
 class MainWindow;
 class SnippingArea;
@@ -43,29 +54,79 @@ public:
     ImageGrabber(MainWindow *parent);
     ~ImageGrabber();
     void grabImage(CaptureMode captureMode, bool capureCursor = true, int delay = 0);
+    void grabBurst(CaptureMode captureMode,
+                   bool captureCursor,
+                   int delay,
+                   int interval,
+                   int frameCount = 0);
+    void grabWatch(CaptureMode captureMode,
+                   bool captureCursor,
+                   int delay,
+                   int frameCount = 0);
+    void grabScroll(int delay);
+    void stopBurst();
     QRect currectScreenRect() const;
 
 signals:
     void finished(const QPixmap &) const;
     void canceled() const;
+    void frameGrabbed(const QImage &frame) const;
+    void burstFinished(int missedFrames) const;
+    void scrollFinished(const QImage &image) const;
 
 private:
-    MainWindow   *mParent;
-    SnippingArea *mSnippingArea;
-    QRect         mCaptureRect;
-    bool          mCaptureCursor;
-    int           mCaptureDelay;
-    const int     mMinCaptureDelay = 200;
-    CaptureMode   mCaptureMode;
+    MainWindow    *mParent;
+    SnippingArea  *mSnippingArea;
+    X11ShmGrabber *mShmGrabber;
+    QRect          mCaptureRect;
+    bool           mCaptureCursor;
+    int            mCaptureDelay;
+    const int      mMinCaptureDelay = 200;
+    CaptureMode    mCaptureMode;
+    bool           mIsBurst;
+    QTimer        *mBurstTimer;
+    QElapsedTimer  mBurstClock;
+    int            mBurstInterval;
+    int            mBurstFrameCount;
+    int            mBurstTick;
+    int            mBurstMissedFrames;
+    bool           mIsWatch;
+    X11DamageWatcher *mDamageWatcher;
+    QTimer        *mWatchTimer;
+    QImage         mWatchFrame;
+    QRegion        mWatchDamage;
+    QPoint         mWatchOffset;
+    qint64         mWatchMinArea;
+    const int      mWatchCoalesceDelay = 50;
+    const int      mMaxDamageRects = 16;
+    const int      mWatchFullGrabRatio = 4;
+    bool           mIsScroll;
+    ScrollStitcher *mStitcher;
+    QTimer        *mScrollTimer;
+    int            mScrollIdleTime;
+    const int      mScrollInterval = 100;
+    const int      mMaxScrollIdleTime = 3000;
 
     void openSnippingArea();
     int getDelay() const;
     void setRectFromCorrectSource();
     QPixmap createPixmap(const QRect& rect) const;
+    QPixmap grabScreenRect(const QRect& rect) const;
+    QImage createImage(const QRect& rect) const;
+    QImage createFullScreenImage(const QRect& rect) const;
+    void startBurst();
+    void startWatch();
+    void emitWatchFrame();
+    void startScroll();
+    qint64 area(const QRegion &region) const;
     void initSnippingAreaIfRequired();
 
 private slots:
     void grabRect();
+    void grabBurstFrame();
+    void addDamage(const QRect &area);
+    void grabChangedFrame();
+    void grabScrollFrame();
 };
 
 #endif // IMAGEGRABBER_H
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "ImageSaver.h"
+
+Q_LOGGING_CATEGORY(ksnipSave, "ksnip.save", QtWarningMsg)
+
+ImageSaver::ImageSaver(QObject* parent) : QObject(parent),
+    mNextId(0)
+{
+}
+
+/*
+ * Pending writes are not canceled, we rather block until they are done than
+ * leaving half written files behind.
+ */
+ImageSaver::~ImageSaver()
+{
+    waitForFinished();
+}
+
+//
+// Public Functions
+//
+
+/*
+ * Encodes and writes the image on a worker thread, the caller returns right
+ * away. The image is implicitly shared, any later modification on the caller
+ * side detaches it, so the worker always writes the state the image had when
+ * save was called. The signals are emitted on the thread this object lives
+ * in, finished after the file was written and closed. Returns the id the
+ * signals of this save carry, two saves to the same path can be told apart by
+ * it.
+ */
+int ImageSaver::save(const QImage& image, const QString& path)
+{
+    auto id = mNextId++;
+    auto watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, [this, watcher, id, path]() {
+        mWatchers.removeOne(watcher);
+        mProgress.remove(id);
+        watcher->deleteLater();
+        emit finished(id, path, watcher->result());
+        if (!mProgress.isEmpty()) {
+            emit progressChanged(progress());
+        }
+    });
+    mWatchers.append(watcher);
+    mProgress[id] = 0;
+
+    // The config is not thread safe, so the encoder is set up here and handed
+    // over to the worker as a copy. Progress is reported from the worker, the
+    // queued call hands it over to this thread.
+    PngEncoder encoder;
+    encoder.setCompressionLevel(KsnipConfig::instance()->saveCompressionLevel());
+    encoder.setThreadCount(KsnipConfig::instance()->saveThreadCount());
+    encoder.setProgressFunction([this, id](int percent) {
+        QMetaObject::invokeMethod(this, "updateProgress", Qt::QueuedConnection,
+                                  Q_ARG(int, id),
+                                  Q_ARG(int, percent));
+    });
+
+    emit started(id, path);
+    emit progressChanged(progress());
+    watcher->setFuture(QtConcurrent::run(&ImageSaver::writeImage, image, path, encoder));
+    return id;
+}
+
+bool ImageSaver::isSaving() const
+{
+    return !mWatchers.isEmpty();
+}
+
+/*
+ * Blocks until all pending writes have landed, used when the application is
+ * about to quit. The finished signals are still delivered via the event loop.
+ */
+void ImageSaver::waitForFinished()
+{
+    for (auto watcher : mWatchers) {
+        watcher->waitForFinished();
+    }
+}
+
+/*
+ * Runs on the worker thread. PNG files are written with our own encoder which
+ * compresses on all cores, other formats are left to Qt's writer which picks
+ * the format from the file suffix, same as QImage::save() does.
+ */
+bool ImageSaver::writeImage(const QImage& image, const QString& path, const PngEncoder& encoder)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    if (PngEncoder::canWrite(path)) {
+        if (!encoder.write(image, path)) {
+            return false;
+        }
+        qCDebug(ksnipSave, "Wrote %dx%d PNG with level %d on %d threads using %s filters in %lld ms",
+                image.width(),
+                image.height(),
+                encoder.compressionLevel(),
+                encoder.threadCount(),
+                qPrintable(PngRowFilter::implementation()),
+                timer.elapsed());
+        return true;
+    }
+
+    QImageWriter writer(path);
+    if (!writer.write(image)) {
+        qCritical("ImageSaver::writeImage: Unable to write '%s': %s",
+                  qPrintable(path),
+                  qPrintable(writer.errorString()));
+        return false;
+    }
+    qCDebug(ksnipSave, "Wrote %dx%d image with QImageWriter in %lld ms",
+            image.width(),
+            image.height(),
+            timer.elapsed());
+    return true;
+}
+
+//
+// Private Functions
+//
+
+/*
+ * Overall progress of all pending saves in percent.
+ */
+int ImageSaver::progress() const
+{
+    if (mProgress.isEmpty()) {
+        return 100;
+    }
+
+    auto sum = 0;
+    for (auto percent : mProgress) {
+        sum += percent;
+    }
+    return sum / mProgress.count();
+}
+
+//
+// Private Slots
+//
+
+void ImageSaver::updateProgress(int id, int percent)
+{
+    // Progress can arrive after the save already finished
+    if (!mProgress.contains(id)) {
+        return;
+    }
+
+    mProgress[id] = percent;
+    emit progressChanged(progress());
+}
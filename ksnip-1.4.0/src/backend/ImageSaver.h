@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef IMAGESAVER_H
+#define IMAGESAVER_H
+
+#include <QObject>
+#include <QImage>
+#include <QImageWriter>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <QHash>
+
+#include "PngEncoder.h"
+#include "KsnipConfig.h"
+
+Q_DECLARE_LOGGING_CATEGORY(ksnipSave)
+
+class ImageSaver : public QObject
+{
+    Q_OBJECT
+public:
+    ImageSaver(QObject *parent = 0);
+    ~ImageSaver();
+    int save(const QImage &image, const QString &path);
+    bool isSaving() const;
+    void waitForFinished();
+    static bool writeImage(const QImage &image, const QString &path, const PngEncoder &encoder);
+
+signals:
+    void started(int id, const QString &path) const;
+    void progressChanged(int percent) const;
+    void finished(int id, const QString &path, bool success) const;
+
+private:
+    QList<QFutureWatcher<bool>*> mWatchers;
+    QHash<int, int>              mProgress;
+    int                          mNextId;
+
+    int progress() const;
+
+private slots:
+    void updateProgress(int id, int percent);
+};
+
+#endif // IMAGESAVER_H
@@ -20,9 +20,39 @@
 
 #include "KsnipConfig.h"
 
-KsnipConfig::KsnipConfig(QObject* parent) : QObject(parent)
-{
+KsnipConfig::KsnipConfig(QObject* parent) : QObject(parent),
+    mSyncTimer(new QTimer(this)),
+    mSettingsWatcher(nullptr),
+    mSyncPending(false),
+    mSyncCount(0)
+{
+    // Every setting is read once, getters are served from memory afterwards
+    // and setters only update memory and schedule a disk write.
+    loadSettings();
+
+    mSyncTimer->setSingleShot(true);
+    mSyncTimer->setInterval(mSyncDelay);
+    connect(mSyncTimer, &QTimer::timeout, this, &KsnipConfig::sync);
+
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
+                this, &KsnipConfig::sync);
+
+        mSettingsWatcher = new QFileSystemWatcher(this);
+        connect(mSettingsWatcher, &QFileSystemWatcher::fileChanged,
+                this, &KsnipConfig::reloadSettings);
+        watchSettingsFile();
+    }
+}
 
+KsnipConfig::~KsnipConfig()
+{
+    // QSettings would write on destruction too, but the counter should reflect
+    // every write.
+    if (mSyncPending) {
+        mConfig.sync();
+        mSyncCount++;
+    }
 }
 
 //
@@ -35,11 +65,38 @@ KsnipConfig* KsnipConfig::instance()
     return &instance;
 }
 
+/*
+ * Writes pending changes to disk right away instead of waiting for the sync
+ * timer. Does nothing when there is nothing to write.
+ */
+void KsnipConfig::sync()
+{
+    mSyncTimer->stop();
+    if (!mSyncPending) {
+        return;
+    }
+    mConfig.sync();
+    mSyncPending = false;
+    mSyncCount++;
+
+    mLastWrite = QFileInfo(mConfig.fileName()).lastModified();
+    watchSettingsFile();
+}
+
+/*
+ * Returns how often the settings have been written to disk since start, can be
+ * used to verify that changes are really batched.
+ */
+int KsnipConfig::syncCount() const
+{
+    return mSyncCount;
+}
+
 // Application
 
 bool KsnipConfig::saveKsnipPosition() const
 {
-    return mConfig.value("Application/SaveKsnipPosition", true).toBool();
+    return mSaveKsnipPosition;
 }
 
 void KsnipConfig::setSaveKsnipPosition(bool  enabled)
@@ -47,13 +104,13 @@ void KsnipConfig::setSaveKsnipPosition(bool  enabled)
     if (saveKsnipPosition() == enabled) {
         return;
     }
-    mConfig.setValue("Application/SaveKsnipPosition", enabled);
-    mConfig.sync();
+    mSaveKsnipPosition = enabled;
+    saveValue("Application/SaveKsnipPosition", enabled);
 }
 
 bool KsnipConfig::promptSaveBeforeExit() const
 {
-    return mConfig.value("Application/PromptSaveBeforeExit", false).toBool();
+    return mPromptSaveBeforeExit;
 }
 
 void KsnipConfig::setPromptSaveBeforeExit(bool  enabled)
@@ -61,13 +118,13 @@ void KsnipConfig::setPromptSaveBeforeExit(bool  enabled)
     if (promptSaveBeforeExit() == enabled) {
         return;
     }
-    mConfig.setValue("Application/PromptSaveBeforeExit", enabled);
-    mConfig.sync();
+    mPromptSaveBeforeExit = enabled;
+    saveValue("Application/PromptSaveBeforeExit", enabled);
 }
 
 bool KsnipConfig::alwaysCopyToClipboard() const
 {
-    return mConfig.value("Application/AlwaysCopyToClipboard", false).toBool();
+    return mAlwaysCopyToClipboard;
 }
 
 void KsnipConfig::setAlwaysCopyToClipboard(bool  enabled)
@@ -75,13 +132,13 @@ void KsnipConfig::setAlwaysCopyToClipboard(bool  enabled)
     if (alwaysCopyToClipboard() == enabled) {
         return;
     }
-    mConfig.setValue("Application/AlwaysCopyToClipboard", enabled);
-    mConfig.sync();
+    mAlwaysCopyToClipboard = enabled;
+    saveValue("Application/AlwaysCopyToClipboard", enabled);
 }
 
 bool KsnipConfig::saveKsnipToolSelection() const
 {
-    return mConfig.value("Application/SaveKsnipToolsSelection", true).toBool();
+    return mSaveKsnipToolSelection;
 }
 
 void KsnipConfig::setSaveKsnipToolSelection(bool  enabled)
@@ -89,13 +146,13 @@ void KsnipConfig::setSaveKsnipToolSelection(bool  enabled)
     if (saveKsnipToolSelection() == enabled) {
         return;
     }
-    mConfig.setValue("Application/SaveKsnipToolsSelection", enabled);
-    mConfig.sync();
+    mSaveKsnipToolSelection = enabled;
+    saveValue("Application/SaveKsnipToolsSelection", enabled);
 }
 
 bool KsnipConfig::captureOnStartup() const
 {
-    return mConfig.value("Application/CaptureOnStartup", false).toBool();
+    return mCaptureOnStartup;
 }
 
 void KsnipConfig::setCaptureOnStartup(bool enabled)
@@ -103,8 +160,8 @@ void KsnipConfig::setCaptureOnStartup(bool enabled)
     if (captureOnStartup() == enabled) {
         return;
     }
-    mConfig.setValue("Application/CaptureOnStartup", enabled);
-    mConfig.sync();
+    mCaptureOnStartup = enabled;
+    saveValue("Application/CaptureOnStartup", enabled);
 }
 
 QPoint KsnipConfig::windowPosition() const
@@ -115,7 +172,7 @@ QPoint KsnipConfig::windowPosition() const
         return QPoint(200, 200);
     }
 
-    return mConfig.value("MainWindow/Position", QPoint(200, 200)).value<QPoint>();
+    return mWindowPosition;
 }
 
 void KsnipConfig::setWindowPosition(const QPoint& position)
@@ -123,8 +180,8 @@ void KsnipConfig::setWindowPosition(const QPoint& position)
     if (windowPosition() == position) {
         return;
     }
-    mConfig.setValue("MainWindow/Position", position);
-    mConfig.sync();
+    mWindowPosition = position;
+    saveValue("MainWindow/Position", position);
 }
 
 Painter::Modes KsnipConfig::paintMode() const
@@ -134,7 +191,7 @@ Painter::Modes KsnipConfig::paintMode() const
         return Painter::Pen;
     }
 
-    return Painter::Modes(mConfig.value("Painter/PaintMode").toInt());
+    return mPaintMode;
 }
 
 void KsnipConfig::setPaintMode(Painter::Modes mode)
@@ -142,8 +199,8 @@ void KsnipConfig::setPaintMode(Painter::Modes mode)
     if (paintMode() == mode) {
         return;
     }
-    mConfig.setValue("Painter/PaintMode", mode);
-    mConfig.sync();
+    mPaintMode = mode;
+    saveValue("Painter/PaintMode", mode);
 }
 
 ImageGrabber::CaptureMode KsnipConfig::captureMode() const
@@ -153,19 +210,7 @@ ImageGrabber::CaptureMode KsnipConfig::captureMode() const
         return ImageGrabber::RectArea;
     }
 
-    switch (mConfig.value("ImageGrabber/CaptureMode").toInt()) {
-    case ImageGrabber::ActiveWindow:
-        return ImageGrabber::ActiveWindow;
-
-    case ImageGrabber::CurrentScreen:
-        return ImageGrabber::CurrentScreen;
-
-    case ImageGrabber::FullScreen:
-        return ImageGrabber::FullScreen;
-
-    default:
-        return ImageGrabber::RectArea;
-    }
+    return mCaptureMode;
 }
 
 void KsnipConfig::setCaptureMode(ImageGrabber::CaptureMode mode)
@@ -173,14 +218,14 @@ void KsnipConfig::setCaptureMode(ImageGrabber::CaptureMode mode)
     if (captureMode() == mode) {
         return;
     }
-    mConfig.setValue("ImageGrabber/CaptureMode", mode);
-    mConfig.sync();
+    mCaptureMode = mode;
+    saveValue("ImageGrabber/CaptureMode", mode);
 }
 
 QString KsnipConfig::saveDirectory() const
 {
-    if (!mConfig.value("Application/SaveDirectory", QDir::homePath()).toString().isEmpty()) {
-        return mConfig.value("Application/SaveDirectory", QDir::homePath()).toString() + "/";
+    if (!mSaveDirectory.isEmpty()) {
+        return mSaveDirectory + "/";
     } else {
         return QString();
     }
@@ -191,13 +236,13 @@ void KsnipConfig::setSaveDirectory(const QString& path)
     if (saveDirectory() == path) {
         return;
     }
-    mConfig.setValue("Application/SaveDirectory", path);
-    mConfig.sync();
+    mSaveDirectory = path;
+    saveValue("Application/SaveDirectory", path);
 }
 
 QString KsnipConfig::saveFilename() const
 {
-    return mConfig.value("Application/SaveFilename", "ksnip_$Y$M$D$").toString();
+    return mSaveFilename;
 }
 
 void KsnipConfig::setSaveFilename(const QString& filename)
@@ -205,14 +250,14 @@ void KsnipConfig::setSaveFilename(const QString& filename)
     if (saveFilename() == filename) {
         return;
     }
-    mConfig.setValue("Application/SaveFilename", filename);
-    mConfig.sync();
+    mSaveFilename = filename;
+    saveValue("Application/SaveFilename", filename);
 }
 
 QString KsnipConfig::saveFormat() const
 {
-    if (!mConfig.value("Application/SaveFormat", "png").toString().isEmpty()) {
-        return "." + mConfig.value("Application/SaveFormat", "png").toString();
+    if (!mSaveFormat.isEmpty()) {
+        return "." + mSaveFormat;
     } else {
         return QString();
     }
@@ -223,8 +268,8 @@ void KsnipConfig::setSaveFormat(const QString& format)
     if (saveFormat() == format) {
         return;
     }
-    mConfig.setValue("Application/SaveFormat", format);
-    mConfig.sync();
+    mSaveFormat = format;
+    saveValue("Application/SaveFormat", format);
 }
 
 /*
@@ -245,6 +290,37 @@ QString KsnipConfig::savePath(const QString& format) const
     return StringFormattingHelper::makeUniqueFilename(saveDirectory(), filename, selectedFormat);
 }
 
+int KsnipConfig::saveCompressionLevel() const
+{
+    return mSaveCompressionLevel;
+}
+
+void KsnipConfig::setSaveCompressionLevel(int level)
+{
+    if (saveCompressionLevel() == level) {
+        return;
+    }
+    mSaveCompressionLevel = level;
+    saveValue("Application/SaveCompressionLevel", level);
+}
+
+/*
+ * Number of threads used for compressing PNG files, zero uses all cores.
+ */
+int KsnipConfig::saveThreadCount() const
+{
+    return mSaveThreadCount;
+}
+
+void KsnipConfig::setSaveThreadCount(int count)
+{
+    if (saveThreadCount() == count) {
+        return;
+    }
+    mSaveThreadCount = count;
+    saveValue("Application/SaveThreadCount", count);
+}
+
 // Painter
 
 QPen KsnipConfig::pen() const
@@ -257,7 +333,7 @@ QPen KsnipConfig::pen() const
 
 QColor KsnipConfig::penColor() const
 {
-    return mConfig.value("Painter/PenColor", QColor("Red")).value<QColor>();
+    return mPenColor;
 }
 
 void KsnipConfig::setPenColor(const QColor& color)
@@ -265,14 +341,14 @@ void KsnipConfig::setPenColor(const QColor& color)
     if (penColor() == color) {
         return;
     }
-    mConfig.setValue("Painter/PenColor", color);
-    mConfig.sync();
+    mPenColor = color;
+    saveValue("Painter/PenColor", color);
     emit painterUpdated();
 }
 
 int KsnipConfig::penSize() const
 {
-    return mConfig.value("Painter/PenSize", 3).toInt();
+    return mPenSize;
 }
 
 void KsnipConfig::setPenSize(int  size)
@@ -280,8 +356,8 @@ void KsnipConfig::setPenSize(int  size)
     if (penSize() == size) {
         return;
     }
-    mConfig.setValue("Painter/PenSize", size);
-    mConfig.sync();
+    mPenSize = size;
+    saveValue("Painter/PenSize", size);
     emit painterUpdated();
 }
 
@@ -295,7 +371,7 @@ QPen KsnipConfig::marker() const
 
 QColor KsnipConfig::markerColor() const
 {
-    return mConfig.value("Painter/MarkerColor", QColor("Yellow")).value<QColor>();
+    return mMarkerColor;
 }
 
 void KsnipConfig::setMarkerColor(const QColor& color)
@@ -303,14 +379,14 @@ void KsnipConfig::setMarkerColor(const QColor& color)
     if (markerColor() == color) {
         return;
     }
-    mConfig.setValue("Painter/MarkerColor", color);
-    mConfig.sync();
+    mMarkerColor = color;
+    saveValue("Painter/MarkerColor", color);
     emit painterUpdated();
 }
 
 int KsnipConfig::markerSize() const
 {
-    return mConfig.value("Painter/MarkerSize", 20).toInt();
+    return mMarkerSize;
 }
 
 void KsnipConfig::setMarkerSize(int  size)
@@ -318,8 +394,8 @@ void KsnipConfig::setMarkerSize(int  size)
     if (markerSize() == size) {
         return;
     }
-    mConfig.setValue("Painter/MarkerSize", size);
-    mConfig.sync();
+    mMarkerSize = size;
+    saveValue("Painter/MarkerSize", size);
     emit painterUpdated();
 }
 
@@ -333,7 +409,7 @@ QPen KsnipConfig::rect() const
 
 QColor KsnipConfig::rectColor() const
 {
-    return mConfig.value("Painter/RectColor", QColor("Blue")).value<QColor>();
+    return mRectColor;
 }
 
 void KsnipConfig::setRectColor(const QColor& color)
@@ -341,14 +417,14 @@ void KsnipConfig::setRectColor(const QColor& color)
     if (rectColor() == color) {
         return;
     }
-    mConfig.setValue("Painter/RectColor", color);
-    mConfig.sync();
+    mRectColor = color;
+    saveValue("Painter/RectColor", color);
     emit painterUpdated();
 }
 
 int KsnipConfig::rectSize() const
 {
-    return mConfig.value("Painter/RectSize", 3).toInt();
+    return mRectSize;
 }
 
 void KsnipConfig::setRectSize(int  size)
@@ -356,14 +432,14 @@ void KsnipConfig::setRectSize(int  size)
     if (rectSize() == size) {
         return;
     }
-    mConfig.setValue("Painter/RectSize", size);
-    mConfig.sync();
+    mRectSize = size;
+    saveValue("Painter/RectSize", size);
     emit painterUpdated();
 }
 
 bool KsnipConfig::rectFill() const
 {
-    return mConfig.value("Painter/RectFill", false).toBool();
+    return mRectFill;
 }
 
 void KsnipConfig::setRectFill(bool  fill)
@@ -371,8 +447,8 @@ void KsnipConfig::setRectFill(bool  fill)
     if (rectFill() == fill) {
         return;
     }
-    mConfig.setValue("Painter/RectFill", fill);
-    mConfig.sync();
+    mRectFill = fill;
+    saveValue("Painter/RectFill", fill);
     emit painterUpdated();
 }
 
@@ -386,7 +462,7 @@ QPen KsnipConfig::ellipse() const
 
 QColor KsnipConfig::ellipseColor() const
 {
-    return mConfig.value("Painter/EllipseColor", QColor("Blue")).value<QColor>();
+    return mEllipseColor;
 }
 
 void KsnipConfig::setEllipseColor(const QColor& color)
@@ -394,14 +470,14 @@ void KsnipConfig::setEllipseColor(const QColor& color)
     if (ellipseColor() == color) {
         return;
     }
-    mConfig.setValue("Painter/EllipseColor", color);
-    mConfig.sync();
+    mEllipseColor = color;
+    saveValue("Painter/EllipseColor", color);
     emit painterUpdated();
 }
 
 int KsnipConfig::ellipseSize() const
 {
-    return mConfig.value("Painter/EllipseSize", 3).toInt();
+    return mEllipseSize;
 }
 
 void KsnipConfig::setEllipseSize(int  size)
@@ -409,14 +485,14 @@ void KsnipConfig::setEllipseSize(int  size)
     if (ellipseSize() == size) {
         return;
     }
-    mConfig.setValue("Painter/EllipseSize", size);
-    mConfig.sync();
+    mEllipseSize = size;
+    saveValue("Painter/EllipseSize", size);
     emit painterUpdated();
 }
 
 bool KsnipConfig::ellipseFill() const
 {
-    return mConfig.value("Painter/EllipseFill", false).toBool();
+    return mEllipseFill;
 }
 
 void KsnipConfig::setEllipseFill(bool  fill)
@@ -424,8 +500,8 @@ void KsnipConfig::setEllipseFill(bool  fill)
     if (ellipseFill() == fill) {
         return;
     }
-    mConfig.setValue("Painter/EllipseFill", fill);
-    mConfig.sync();
+    mEllipseFill = fill;
+    saveValue("Painter/EllipseFill", fill);
     emit painterUpdated();
 }
 
@@ -439,7 +515,7 @@ QPen KsnipConfig::line() const
 
 QColor KsnipConfig::lineColor() const
 {
-    return mConfig.value("Painter/LineColor", QColor("Blue")).value<QColor>();
+    return mLineColor;
 }
 
 void KsnipConfig::setLineColor(const QColor& color)
@@ -447,14 +523,14 @@ void KsnipConfig::setLineColor(const QColor& color)
     if (lineColor() == color) {
         return;
     }
-    mConfig.setValue("Painter/LineColor", color);
-    mConfig.sync();
+    mLineColor = color;
+    saveValue("Painter/LineColor", color);
     emit painterUpdated();
 }
 
 int KsnipConfig::lineSize() const
 {
-    return mConfig.value("Painter/LineSize", 3).toInt();
+    return mLineSize;
 }
 
 void KsnipConfig::setLineSize(int size)
@@ -462,14 +538,14 @@ void KsnipConfig::setLineSize(int size)
     if (lineSize() == size) {
         return;
     }
-    mConfig.setValue("Painter/LineSize", size);
-    mConfig.sync();
+    mLineSize = size;
+    saveValue("Painter/LineSize", size);
     emit painterUpdated();
 }
 
 bool KsnipConfig::lineFill() const
 {
-    return mConfig.value("Painter/LineFill", false).toBool();
+    return mLineFill;
 }
 
 void KsnipConfig::setLineFill(bool fill)
@@ -477,8 +553,8 @@ void KsnipConfig::setLineFill(bool fill)
     if (lineFill() == fill) {
         return;
     }
-    mConfig.setValue("Painter/LineFill", fill);
-    mConfig.sync();
+    mLineFill = fill;
+    saveValue("Painter/LineFill", fill);
     emit painterUpdated();
 }
 
@@ -492,7 +568,7 @@ QPen KsnipConfig::arrow() const
 
 QColor KsnipConfig::arrowColor() const
 {
-    return mConfig.value("Painter/ArrowColor", QColor("Blue")).value<QColor>();
+    return mArrowColor;
 }
 
 void KsnipConfig::setArrowColor(const QColor& color)
@@ -500,14 +576,14 @@ void KsnipConfig::setArrowColor(const QColor& color)
     if (arrowColor() == color) {
         return;
     }
-    mConfig.setValue("Painter/ArrowColor", color);
-    mConfig.sync();
+    mArrowColor = color;
+    saveValue("Painter/ArrowColor", color);
     emit painterUpdated();
 }
 
 int KsnipConfig::arrowSize() const
 {
-    return mConfig.value("Painter/ArrowSize", 3).toInt();
+    return mArrowSize;
 }
 
 void KsnipConfig::setArrowSize(int size)
@@ -515,14 +591,14 @@ void KsnipConfig::setArrowSize(int size)
     if (arrowSize() == size) {
         return;
     }
-    mConfig.setValue("Painter/ArrowSize", size);
-    mConfig.sync();
+    mArrowSize = size;
+    saveValue("Painter/ArrowSize", size);
     emit painterUpdated();
 }
 
 bool KsnipConfig::arrowFill() const
 {
-    return mConfig.value("Painter/ArrowFill", false).toBool();
+    return mArrowFill;
 }
 
 void KsnipConfig::setArrowFill(bool fill)
@@ -530,8 +606,8 @@ void KsnipConfig::setArrowFill(bool fill)
     if (arrowFill() == fill) {
         return;
     }
-    mConfig.setValue("Painter/ArrowFill", fill);
-    mConfig.sync();
+    mArrowFill = fill;
+    saveValue("Painter/ArrowFill", fill);
     emit painterUpdated();
 }
 
@@ -545,7 +621,7 @@ QPen KsnipConfig::text() const
 
 QColor KsnipConfig::textColor() const
 {
-    return mConfig.value("Painter/TextColor", QColor("Black")).value<QColor>();
+    return mTextColor;
 }
 
 void KsnipConfig::setTextColor(const QColor& color)
@@ -553,8 +629,8 @@ void KsnipConfig::setTextColor(const QColor& color)
     if (textColor() == color) {
         return;
     }
-    mConfig.setValue("Painter/TextColor", color);
-    mConfig.sync();
+    mTextColor = color;
+    saveValue("Painter/TextColor", color);
     emit painterUpdated();
 }
 
@@ -571,8 +647,8 @@ void KsnipConfig::setTextSize(int  size)
     auto font = textFont();
     font.setPointSize(size);
 
-    mConfig.setValue("Painter/TextFont", font);
-    mConfig.sync();
+    mTextFont = font;
+    saveValue("Painter/TextFont", font);
     emit painterUpdated();
 }
 
@@ -589,8 +665,8 @@ void KsnipConfig::setTextBold(bool  bold)
     auto font = textFont();
     font.setBold(bold);
 
-    mConfig.setValue("Painter/TextFont", font);
-    mConfig.sync();
+    mTextFont = font;
+    saveValue("Painter/TextFont", font);
     emit painterUpdated();
 }
 
@@ -607,8 +683,8 @@ void KsnipConfig::setTextItalic(bool  italic)
     auto font = textFont();
     font.setItalic(italic);
 
-    mConfig.setValue("Painter/TextFont", font);
-    mConfig.sync();
+    mTextFont = font;
+    saveValue("Painter/TextFont", font);
     emit painterUpdated();
 }
 
@@ -625,14 +701,14 @@ void KsnipConfig::setTextUnderline(bool  underline)
     auto font = textFont();
     font.setUnderline(underline);
 
-    mConfig.setValue("Painter/TextFont", font);
-    mConfig.sync();
+    mTextFont = font;
+    saveValue("Painter/TextFont", font);
     emit painterUpdated();
 }
 
 QFont KsnipConfig::textFont() const
 {
-    return mConfig.value("Painter/TextFont", QFont("Arial", 12)).value<QFont>();
+    return mTextFont;
 }
 
 void KsnipConfig::setTextFont(const QFont& font)
@@ -643,8 +719,8 @@ void KsnipConfig::setTextFont(const QFont& font)
     auto tmpFont = textFont();
     tmpFont.setFamily(font.family());
 
-    mConfig.setValue("Painter/TextFont", tmpFont);
-    mConfig.sync();
+    mTextFont = tmpFont;
+    saveValue("Painter/TextFont", tmpFont);
     emit painterUpdated();
 }
 
@@ -658,7 +734,7 @@ QPen KsnipConfig::number() const
 
 QColor KsnipConfig::numberColor() const
 {
-    return mConfig.value("Painter/NumberColor", QColor("Red")).value<QColor>();
+    return mNumberColor;
 }
 
 void KsnipConfig::setNumberColor(const QColor& color)
@@ -666,8 +742,8 @@ void KsnipConfig::setNumberColor(const QColor& color)
     if (numberColor() == color) {
         return;
     }
-    mConfig.setValue("Painter/NumberColor", color);
-    mConfig.sync();
+    mNumberColor = color;
+    saveValue("Painter/NumberColor", color);
     emit painterUpdated();
 }
 
@@ -684,14 +760,14 @@ void KsnipConfig::setNumberSize(int  size)
     auto font = numberFont();
     font.setPointSize(size);
 
-    mConfig.setValue("Painter/NumberFont", font);
-    mConfig.sync();
+    mNumberFont = font;
+    saveValue("Painter/NumberFont", font);
     emit painterUpdated();
 }
 
 QFont KsnipConfig::numberFont() const
 {
-    return mConfig.value("Painter/NumberFont", QFont("Comic Sans MS", 30, QFont::Bold)).value<QFont>();
+    return mNumberFont;
 }
 
 void KsnipConfig::setNumberFont(const QFont& font)
@@ -703,14 +779,54 @@ void KsnipConfig::setNumberFont(const QFont& font)
     tmpFont.setFamily(font.family());
     tmpFont.setBold(true);
 
-    mConfig.setValue("Painter/NumberFont", tmpFont);
-    mConfig.sync();
+    mNumberFont = tmpFont;
+    saveValue("Painter/NumberFont", tmpFont);
+    emit painterUpdated();
+}
+
+/*
+ * The width of the redaction pen is the pixel block size and blur radius.
+ */
+QPen KsnipConfig::redact() const
+{
+    QPen redact;
+    redact.setWidth(redactSize());
+    return redact;
+}
+
+int KsnipConfig::redactSize() const
+{
+    return mRedactSize;
+}
+
+void KsnipConfig::setRedactSize(int  size)
+{
+    if (redactSize() == size) {
+        return;
+    }
+    mRedactSize = size;
+    saveValue("Painter/RedactSize", size);
+    emit painterUpdated();
+}
+
+bool KsnipConfig::redactBlur() const
+{
+    return mRedactBlur;
+}
+
+void KsnipConfig::setRedactBlur(bool  enabled)
+{
+    if (redactBlur() == enabled) {
+        return;
+    }
+    mRedactBlur = enabled;
+    saveValue("Painter/RedactBlur", enabled);
     emit painterUpdated();
 }
 
 int KsnipConfig::eraseSize() const
 {
-    return mConfig.value("Painter/EraseSize", 5).toInt();
+    return mEraseSize;
 }
 
 void KsnipConfig::setEraseSize(int  size)
@@ -718,14 +834,14 @@ void KsnipConfig::setEraseSize(int  size)
     if (eraseSize() == size) {
         return;
     }
-    mConfig.setValue("Painter/EraseSize", size);
-    mConfig.sync();
+    mEraseSize = size;
+    saveValue("Painter/EraseSize", size);
     emit painterUpdated();
 }
 
 bool KsnipConfig::itemShadowEnabled() const
 {
-    return mConfig.value("Painter/ItemShadowEnabled", true).toBool();
+    return mItemShadowEnabled;
 }
 
 void KsnipConfig::setItemShadowEnabled(bool enabled)
@@ -734,13 +850,13 @@ void KsnipConfig::setItemShadowEnabled(bool enabled)
         return;
     }
 
-    mConfig.setValue("Painter/ItemShadowEnabled", enabled);
-    mConfig.sync();
+    mItemShadowEnabled = enabled;
+    saveValue("Painter/ItemShadowEnabled", enabled);
 }
 
 bool KsnipConfig::smoothPathEnabled() const
 {
-    return mConfig.value("Painter/SmoothPathEnabled", true).toBool();
+    return mSmoothPathEnabled;
 }
 
 void KsnipConfig::setSmoothPathEnabled(bool  enabled)
@@ -749,13 +865,13 @@ void KsnipConfig::setSmoothPathEnabled(bool  enabled)
         return;
     }
 
-    mConfig.setValue("Painter/SmoothPathEnabled", enabled);
-    mConfig.sync();
+    mSmoothPathEnabled = enabled;
+    saveValue("Painter/SmoothPathEnabled", enabled);
 }
 
 int KsnipConfig::smoothFactor() const
 {
-    return mConfig.value("Painter/SmoothPathFactor", 7).toInt();
+    return mSmoothFactor;
 }
 
 void KsnipConfig::setSmoothFactor(int  factor)
@@ -764,15 +880,52 @@ void KsnipConfig::setSmoothFactor(int  factor)
         return;
     }
 
-    mConfig.setValue("Painter/SmoothPathFactor", factor);
-    mConfig.sync();
+    mSmoothFactor = factor;
+    saveValue("Painter/SmoothPathFactor", factor);
+}
+
+/*
+ * Maximum distance in pixels a point of a freehand path may deviate from the
+ * stored path, points within it are merged while drawing. Zero keeps every
+ * point.
+ */
+qreal KsnipConfig::pathTolerance() const
+{
+    return mPathTolerance;
+}
+
+void KsnipConfig::setPathTolerance(qreal tolerance)
+{
+    if (pathTolerance() == tolerance) {
+        return;
+    }
+
+    mPathTolerance = tolerance;
+    saveValue("Painter/PathTolerance", tolerance);
+}
+
+/*
+ * Maximum size in megabytes of the data kept alive by the undo history.
+ */
+int KsnipConfig::undoMemoryLimit() const
+{
+    return mUndoMemoryLimit;
+}
+
+void KsnipConfig::setUndoMemoryLimit(int megabytes)
+{
+    if (undoMemoryLimit() == megabytes) {
+        return;
+    }
+    mUndoMemoryLimit = megabytes;
+    saveValue("Painter/UndoMemoryLimit", megabytes);
 }
 
 // Image Grabber
 
 bool KsnipConfig::captureCursor() const
 {
-    return mConfig.value("ImageGrabber/CaptureCursor", true).toBool();
+    return mCaptureCursor;
 }
 
 void KsnipConfig::setCaptureCursor(bool  enabled)
@@ -780,13 +933,13 @@ void KsnipConfig::setCaptureCursor(bool  enabled)
     if (captureCursor() == enabled) {
         return;
     }
-    mConfig.setValue("ImageGrabber/CaptureCursor", enabled);
-    mConfig.sync();
+    mCaptureCursor = enabled;
+    saveValue("ImageGrabber/CaptureCursor", enabled);
 }
 
 bool KsnipConfig::cursorRulerEnabled() const
 {
-    return mConfig.value("ImageGrabber/CursorRulerEnabled", true).toBool();
+    return mCursorRulerEnabled;
 }
 
 void KsnipConfig::setCursorRulerEnabled(bool enabled)
@@ -794,13 +947,13 @@ void KsnipConfig::setCursorRulerEnabled(bool enabled)
     if (cursorRulerEnabled() == enabled) {
         return;
     }
-    mConfig.setValue("ImageGrabber/CursorRulerEnabled", enabled);
-    mConfig.sync();
+    mCursorRulerEnabled = enabled;
+    saveValue("ImageGrabber/CursorRulerEnabled", enabled);
 }
 
 bool KsnipConfig::cursorInfoEnabled() const
 {
-    return mConfig.value("ImageGrabber/CursorInfoEnabled", true).toBool();
+    return mCursorInfoEnabled;
 }
 
 void KsnipConfig::setCursorInfoEnabled(bool enabled)
@@ -808,13 +961,13 @@ void KsnipConfig::setCursorInfoEnabled(bool enabled)
     if (cursorInfoEnabled() == enabled) {
         return;
     }
-    mConfig.setValue("ImageGrabber/CursorInfoEnabled", enabled);
-    mConfig.sync();
+    mCursorInfoEnabled = enabled;
+    saveValue("ImageGrabber/CursorInfoEnabled", enabled);
 }
 
 int KsnipConfig::captureDelay() const
 {
-    return mConfig.value("ImageGrabber/CaptureDelay", 0).toInt();
+    return mCaptureDelay;
 }
 
 void KsnipConfig::setCaptureDelay(int delay)
@@ -822,13 +975,13 @@ void KsnipConfig::setCaptureDelay(int delay)
     if (captureDelay() == delay) {
         return;
     }
-    mConfig.setValue("ImageGrabber/CaptureDelay", delay);
-    mConfig.sync();
+    mCaptureDelay = delay;
+    saveValue("ImageGrabber/CaptureDelay", delay);
 }
 
 int KsnipConfig::snippingCursorSize() const
 {
-    return mConfig.value("ImageGrabber/SnippingCursorSize", 1).toInt();
+    return mSnippingCursorSize;
 }
 
 void KsnipConfig::setSnippingCursorSize(int size)
@@ -836,13 +989,13 @@ void KsnipConfig::setSnippingCursorSize(int size)
     if (snippingCursorSize() == size) {
         return;
     }
-    mConfig.setValue("ImageGrabber/SnippingCursorSize", size);
-    mConfig.sync();
+    mSnippingCursorSize = size;
+    saveValue("ImageGrabber/SnippingCursorSize", size);
 }
 
 QColor KsnipConfig::snippingCursorColor() const
 {
-    return mConfig.value("ImageGrabber/SnippingCursorColor", QColor(27,20,77)).value<QColor>();
+    return mSnippingCursorColor;
 }
 
 void KsnipConfig::setSnippingCursorColor(const QColor& color)
@@ -850,15 +1003,69 @@ void KsnipConfig::setSnippingCursorColor(const QColor& color)
     if (snippingCursorColor() == color) {
         return;
     }
-    mConfig.setValue("ImageGrabber/SnippingCursorColor", color);
-    mConfig.sync();
+    mSnippingCursorColor = color;
+    saveValue("ImageGrabber/SnippingCursorColor", color);
+}
+
+/*
+ * Maximum size in megabytes of capture buffers that are kept around for reuse
+ * by following captures, zero disables keeping buffers.
+ */
+int KsnipConfig::captureBufferPoolSize() const
+{
+    return mCaptureBufferPoolSize;
+}
+
+void KsnipConfig::setCaptureBufferPoolSize(int megabytes)
+{
+    if (captureBufferPoolSize() == megabytes) {
+        return;
+    }
+    mCaptureBufferPoolSize = megabytes;
+    saveValue("ImageGrabber/CaptureBufferPoolSize", megabytes);
+}
+
+/*
+ * Number of frames an interval capture keeps in memory while they wait to be
+ * written, frames captured while all slots are taken are dropped.
+ */
+int KsnipConfig::burstRingSize() const
+{
+    return mBurstRingSize;
+}
+
+void KsnipConfig::setBurstRingSize(int frames)
+{
+    if (burstRingSize() == frames) {
+        return;
+    }
+    mBurstRingSize = frames;
+    saveValue("ImageGrabber/BurstRingSize", frames);
+}
+
+/*
+ * Percentage of the watched area that must have changed before a watching
+ * capture takes the next frame, zero captures on every change.
+ */
+int KsnipConfig::watchChangeThreshold() const
+{
+    return mWatchChangeThreshold;
+}
+
+void KsnipConfig::setWatchChangeThreshold(int percent)
+{
+    if (watchChangeThreshold() == percent) {
+        return;
+    }
+    mWatchChangeThreshold = percent;
+    saveValue("ImageGrabber/WatchChangeThreshold", percent);
 }
 
 // Imgur Uploader
 
 QString KsnipConfig::imgurUsername() const
 {
-    return mConfig.value("Imgur/Username", "").toString();
+    return mImgurUsername;
 }
 
 void KsnipConfig::setImgurUsername(const QString& username)
@@ -866,13 +1073,13 @@ void KsnipConfig::setImgurUsername(const QString& username)
     if (imgurUsername() == username) {
         return;
     }
-    mConfig.setValue("Imgur/Username", username);
-    mConfig.sync();
+    mImgurUsername = username;
+    saveValue("Imgur/Username", username);
 }
 
 QByteArray KsnipConfig::imgurClientId() const
 {
-    return mConfig.value("Imgur/ClientId", "").toByteArray();
+    return mImgurClientId;
 }
 
 void KsnipConfig::setImgurClientId(const QString& clientId)
@@ -880,13 +1087,13 @@ void KsnipConfig::setImgurClientId(const QString& clientId)
     if (imgurClientId() == clientId) {
         return;
     }
-    mConfig.setValue("Imgur/ClientId", clientId);
-    mConfig.sync();
+    mImgurClientId = clientId.toUtf8();
+    saveValue("Imgur/ClientId", clientId);
 }
 
 QByteArray KsnipConfig::imgurClientSecret() const
 {
-    return mConfig.value("Imgur/ClientSecret", "").toByteArray();
+    return mImgurClientSecret;
 }
 
 void KsnipConfig::setImgurClientSecret(const QString& clientSecret)
@@ -894,13 +1101,13 @@ void KsnipConfig::setImgurClientSecret(const QString& clientSecret)
     if (imgurClientSecret() == clientSecret) {
         return;
     }
-    mConfig.setValue("Imgur/ClientSecret", clientSecret);
-    mConfig.sync();
+    mImgurClientSecret = clientSecret.toUtf8();
+    saveValue("Imgur/ClientSecret", clientSecret);
 }
 
 QByteArray KsnipConfig::imgurAccessToken() const
 {
-    return mConfig.value("Imgur/AccessToken", "").toByteArray();
+    return mImgurAccessToken;
 }
 
 void KsnipConfig::setImgurAccessToken(const QString& accessToken)
@@ -908,13 +1115,13 @@ void KsnipConfig::setImgurAccessToken(const QString& accessToken)
     if (imgurAccessToken() == accessToken) {
         return;
     }
-    mConfig.setValue("Imgur/AccessToken", accessToken);
-    mConfig.sync();
+    mImgurAccessToken = accessToken.toUtf8();
+    saveValue("Imgur/AccessToken", accessToken);
 }
 
 QByteArray KsnipConfig::imgurRefreshToken() const
 {
-    return mConfig.value("Imgur/RefreshToken", "").toByteArray();
+    return mImgurRefreshToken;
 }
 
 void KsnipConfig::setImgurRefreshToken(const QString& refreshToken)
@@ -922,13 +1129,13 @@ void KsnipConfig::setImgurRefreshToken(const QString& refreshToken)
     if (imgurRefreshToken() == refreshToken) {
         return;
     }
-    mConfig.setValue("Imgur/RefreshToken", refreshToken);
-    mConfig.sync();
+    mImgurRefreshToken = refreshToken.toUtf8();
+    saveValue("Imgur/RefreshToken", refreshToken);
 }
 
 bool KsnipConfig::imgurForceAnonymous() const
 {
-    return mConfig.value("Imgur/ForceAnonymous", false).toBool();
+    return mImgurForceAnonymous;
 }
 
 void KsnipConfig::setImgurForceAnonymous(bool  enabled)
@@ -936,13 +1143,13 @@ void KsnipConfig::setImgurForceAnonymous(bool  enabled)
     if (imgurForceAnonymous() == enabled) {
         return;
     }
-    mConfig.setValue("Imgur/ForceAnonymous", enabled);
-    mConfig.sync();
+    mImgurForceAnonymous = enabled;
+    saveValue("Imgur/ForceAnonymous", enabled);
 }
 
 bool KsnipConfig::imgurOpenLinkDirectlyToImage() const
 {
-    return mConfig.value("Imgur/OpenLinkDirectlyToImage", false).toBool();
+    return mImgurOpenLinkDirectlyToImage;
 }
 
 void KsnipConfig::setImgurOpenLinkDirectlyToImage(bool  enabled)
@@ -950,13 +1157,13 @@ void KsnipConfig::setImgurOpenLinkDirectlyToImage(bool  enabled)
     if (imgurOpenLinkDirectlyToImage() == enabled) {
         return;
     }
-    mConfig.setValue("Imgur/OpenLinkDirectlyToImage", enabled);
-    mConfig.sync();
+    mImgurOpenLinkDirectlyToImage = enabled;
+    saveValue("Imgur/OpenLinkDirectlyToImage", enabled);
 }
 
 bool KsnipConfig::imgurAlwaysCopyToClipboard() const
 {
-    return mConfig.value("Imgur/AlwaysCopyToClipboard", false).toBool();
+    return mImgurAlwaysCopyToClipboard;
 }
 
 void KsnipConfig::setImgurAlwaysCopyToClipboard(bool  enabled)
@@ -964,6 +1171,138 @@ void KsnipConfig::setImgurAlwaysCopyToClipboard(bool  enabled)
     if (imgurAlwaysCopyToClipboard() == enabled) {
         return;
     }
-    mConfig.setValue("Imgur/AlwaysCopyToClipboard", enabled);
-    mConfig.sync();
+    mImgurAlwaysCopyToClipboard = enabled;
+    saveValue("Imgur/AlwaysCopyToClipboard", enabled);
+}
+
+//
+// Private Functions
+//
+
+void KsnipConfig::loadSettings()
+{
+    mSaveKsnipPosition = mConfig.value("Application/SaveKsnipPosition", true).toBool();
+    mPromptSaveBeforeExit = mConfig.value("Application/PromptSaveBeforeExit", false).toBool();
+    mAlwaysCopyToClipboard = mConfig.value("Application/AlwaysCopyToClipboard", false).toBool();
+    mSaveKsnipToolSelection = mConfig.value("Application/SaveKsnipToolsSelection", true).toBool();
+    mCaptureOnStartup = mConfig.value("Application/CaptureOnStartup", false).toBool();
+    mWindowPosition = mConfig.value("MainWindow/Position", QPoint(200, 200)).value<QPoint>();
+    mPaintMode = Painter::Modes(mConfig.value("Painter/PaintMode").toInt());
+    mCaptureMode = loadCaptureMode();
+    mSaveDirectory = mConfig.value("Application/SaveDirectory", QDir::homePath()).toString();
+    mSaveFilename = mConfig.value("Application/SaveFilename", "ksnip_$Y$M$D$").toString();
+    mSaveFormat = mConfig.value("Application/SaveFormat", "png").toString();
+    mSaveCompressionLevel = mConfig.value("Application/SaveCompressionLevel", 6).toInt();
+    mSaveThreadCount = mConfig.value("Application/SaveThreadCount", 0).toInt();
+    mPenColor = mConfig.value("Painter/PenColor", QColor("Red")).value<QColor>();
+    mPenSize = mConfig.value("Painter/PenSize", 3).toInt();
+    mMarkerColor = mConfig.value("Painter/MarkerColor", QColor("Yellow")).value<QColor>();
+    mMarkerSize = mConfig.value("Painter/MarkerSize", 20).toInt();
+    mRectColor = mConfig.value("Painter/RectColor", QColor("Blue")).value<QColor>();
+    mRectSize = mConfig.value("Painter/RectSize", 3).toInt();
+    mRectFill = mConfig.value("Painter/RectFill", false).toBool();
+    mEllipseColor = mConfig.value("Painter/EllipseColor", QColor("Blue")).value<QColor>();
+    mEllipseSize = mConfig.value("Painter/EllipseSize", 3).toInt();
+    mEllipseFill = mConfig.value("Painter/EllipseFill", false).toBool();
+    mLineColor = mConfig.value("Painter/LineColor", QColor("Blue")).value<QColor>();
+    mLineSize = mConfig.value("Painter/LineSize", 3).toInt();
+    mLineFill = mConfig.value("Painter/LineFill", false).toBool();
+    mArrowColor = mConfig.value("Painter/ArrowColor", QColor("Blue")).value<QColor>();
+    mArrowSize = mConfig.value("Painter/ArrowSize", 3).toInt();
+    mArrowFill = mConfig.value("Painter/ArrowFill", false).toBool();
+    mTextColor = mConfig.value("Painter/TextColor", QColor("Black")).value<QColor>();
+    mTextFont = mConfig.value("Painter/TextFont", QFont("Arial", 12)).value<QFont>();
+    mNumberColor = mConfig.value("Painter/NumberColor", QColor("Red")).value<QColor>();
+    mNumberFont = mConfig.value("Painter/NumberFont", QFont("Comic Sans MS", 30, QFont::Bold)).value<QFont>();
+    mRedactSize = mConfig.value("Painter/RedactSize", 10).toInt();
+    mRedactBlur = mConfig.value("Painter/RedactBlur", false).toBool();
+    mEraseSize = mConfig.value("Painter/EraseSize", 5).toInt();
+    mItemShadowEnabled = mConfig.value("Painter/ItemShadowEnabled", true).toBool();
+    mSmoothPathEnabled = mConfig.value("Painter/SmoothPathEnabled", true).toBool();
+    mSmoothFactor = mConfig.value("Painter/SmoothPathFactor", 7).toInt();
+    mPathTolerance = mConfig.value("Painter/PathTolerance", 0.5).toReal();
+    mUndoMemoryLimit = mConfig.value("Painter/UndoMemoryLimit", 128).toInt();
+    mCaptureCursor = mConfig.value("ImageGrabber/CaptureCursor", true).toBool();
+    mCursorRulerEnabled = mConfig.value("ImageGrabber/CursorRulerEnabled", true).toBool();
+    mCursorInfoEnabled = mConfig.value("ImageGrabber/CursorInfoEnabled", true).toBool();
+    mCaptureDelay = mConfig.value("ImageGrabber/CaptureDelay", 0).toInt();
+    mSnippingCursorSize = mConfig.value("ImageGrabber/SnippingCursorSize", 1).toInt();
+    mSnippingCursorColor = mConfig.value("ImageGrabber/SnippingCursorColor", QColor(27,20,77)).value<QColor>();
+    mCaptureBufferPoolSize = mConfig.value("ImageGrabber/CaptureBufferPoolSize", 256).toInt();
+    mBurstRingSize = mConfig.value("ImageGrabber/BurstRingSize", 8).toInt();
+    mWatchChangeThreshold = mConfig.value("ImageGrabber/WatchChangeThreshold", 1).toInt();
+    mImgurUsername = mConfig.value("Imgur/Username", "").toString();
+    mImgurClientId = mConfig.value("Imgur/ClientId", "").toByteArray();
+    mImgurClientSecret = mConfig.value("Imgur/ClientSecret", "").toByteArray();
+    mImgurAccessToken = mConfig.value("Imgur/AccessToken", "").toByteArray();
+    mImgurRefreshToken = mConfig.value("Imgur/RefreshToken", "").toByteArray();
+    mImgurForceAnonymous = mConfig.value("Imgur/ForceAnonymous", false).toBool();
+    mImgurOpenLinkDirectlyToImage = mConfig.value("Imgur/OpenLinkDirectlyToImage", false).toBool();
+    mImgurAlwaysCopyToClipboard = mConfig.value("Imgur/AlwaysCopyToClipboard", false).toBool();
+}
+
+ImageGrabber::CaptureMode KsnipConfig::loadCaptureMode() const
+{
+    switch (mConfig.value("ImageGrabber/CaptureMode").toInt()) {
+    case ImageGrabber::ActiveWindow:
+        return ImageGrabber::ActiveWindow;
+
+    case ImageGrabber::CurrentScreen:
+        return ImageGrabber::CurrentScreen;
+
+    case ImageGrabber::FullScreen:
+        return ImageGrabber::FullScreen;
+
+    default:
+        return ImageGrabber::RectArea;
+    }
+}
+
+/*
+ * The file is replaced on every write, which drops it from the watcher, and
+ * doesn't exist before the first write.
+ */
+void KsnipConfig::watchSettingsFile()
+{
+    auto fileName = mConfig.fileName();
+    if (mSettingsWatcher && !mSettingsWatcher->files().contains(fileName) && QFile::exists(fileName)) {
+        mSettingsWatcher->addPath(fileName);
+    }
+}
+
+/*
+ * Stores the value in QSettings and restarts the sync timer so that a burst of
+ * changes, for example while dragging a size slider, ends up in a single disk
+ * write.
+ */
+void KsnipConfig::saveValue(const QString& key, const QVariant& value)
+{
+    mConfig.setValue(key, value);
+    mSyncPending = true;
+    mSyncTimer->start();
+}
+
+//
+// Private Slots
+//
+
+/*
+ * Picks up settings written by another ksnip instance, for example changes
+ * made in the settings dialog while a capture daemon is running. Own writes
+ * are skipped, their values are already in memory.
+ */
+void KsnipConfig::reloadSettings()
+{
+    watchSettingsFile();
+    if (QFileInfo(mConfig.fileName()).lastModified() == mLastWrite) {
+        return;
+    }
+
+    if (mSyncPending) {
+        sync();
+    } else {
+        mConfig.sync();
+    }
+    loadSettings();
+    emit painterUpdated();
 }
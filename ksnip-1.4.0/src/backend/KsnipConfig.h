@@ -25,6 +25,11 @@
 #include <QDirModel>
 #include <QPoint>
 #include <QSettings>
+#include <QTimer>
+#include <QFileSystemWatcher>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QCoreApplication>
 
 #include "ImageGrabber.h"
 #include "src/helper/StringFormattingHelper.h"
@@ -36,9 +41,13 @@ class KsnipConfig : public QObject
 
 public:
     KsnipConfig(QObject *parent = 0);
+    ~KsnipConfig();
 
     static KsnipConfig *instance();
 
+    void sync();
+    int syncCount() const;
+
     // Application
 
     bool saveKsnipPosition() const;
@@ -76,6 +85,12 @@ public:
 
     QString savePath(const QString &format = QString()) const;
 
+    int saveCompressionLevel() const;
+    void setSaveCompressionLevel(int level);
+
+    int saveThreadCount() const;
+    void setSaveThreadCount(int count);
+
     // Painter
 
     QPen pen() const;
@@ -169,6 +184,14 @@ public:
     QFont numberFont() const;
     void setNumberFont(const QFont &font);
 
+    QPen redact() const;
+
+    int redactSize() const;
+    void setRedactSize(int size);
+
+    bool redactBlur() const;
+    void setRedactBlur(bool enabled);
+
     int eraseSize() const;
     void setEraseSize(int size);
 
@@ -181,6 +204,12 @@ public:
     int smoothFactor() const;
     void setSmoothFactor(int factor);
 
+    qreal pathTolerance() const;
+    void setPathTolerance(qreal tolerance);
+
+    int undoMemoryLimit() const;
+    void setUndoMemoryLimit(int megabytes);
+
     // Image Grabber
 
     bool captureCursor() const;
@@ -201,6 +230,15 @@ public:
     QColor snippingCursorColor() const;
     void setSnippingCursorColor(const QColor &color);
 
+    int captureBufferPoolSize() const;
+    void setCaptureBufferPoolSize(int megabytes);
+
+    int burstRingSize() const;
+    void setBurstRingSize(int frames);
+
+    int watchChangeThreshold() const;
+    void setWatchChangeThreshold(int percent);
+
     // Imgur Uploader
 
     QString imgurUsername() const;
@@ -231,7 +269,80 @@ signals:
     void painterUpdated() const;
 
 private:
-    QSettings mConfig;
+    QSettings                 mConfig;
+    QTimer                   *mSyncTimer;
+    QFileSystemWatcher       *mSettingsWatcher;
+    QDateTime                 mLastWrite;
+    bool                      mSyncPending;
+    int                       mSyncCount;
+    const int                 mSyncDelay = 1000;
+
+    bool                      mSaveKsnipPosition;
+    bool                      mPromptSaveBeforeExit;
+    bool                      mAlwaysCopyToClipboard;
+    bool                      mSaveKsnipToolSelection;
+    bool                      mCaptureOnStartup;
+    QPoint                    mWindowPosition;
+    Painter::Modes            mPaintMode;
+    ImageGrabber::CaptureMode mCaptureMode;
+    QString                   mSaveDirectory;
+    QString                   mSaveFilename;
+    QString                   mSaveFormat;
+    int                       mSaveCompressionLevel;
+    int                       mSaveThreadCount;
+    QColor                    mPenColor;
+    int                       mPenSize;
+    QColor                    mMarkerColor;
+    int                       mMarkerSize;
+    QColor                    mRectColor;
+    int                       mRectSize;
+    bool                      mRectFill;
+    QColor                    mEllipseColor;
+    int                       mEllipseSize;
+    bool                      mEllipseFill;
+    QColor                    mLineColor;
+    int                       mLineSize;
+    bool                      mLineFill;
+    QColor                    mArrowColor;
+    int                       mArrowSize;
+    bool                      mArrowFill;
+    QColor                    mTextColor;
+    QFont                     mTextFont;
+    QColor                    mNumberColor;
+    QFont                     mNumberFont;
+    int                       mRedactSize;
+    bool                      mRedactBlur;
+    int                       mEraseSize;
+    bool                      mItemShadowEnabled;
+    bool                      mSmoothPathEnabled;
+    int                       mSmoothFactor;
+    qreal                     mPathTolerance;
+    int                       mUndoMemoryLimit;
+    bool                      mCaptureCursor;
+    bool                      mCursorRulerEnabled;
+    bool                      mCursorInfoEnabled;
+    int                       mCaptureDelay;
+    int                       mSnippingCursorSize;
+    QColor                    mSnippingCursorColor;
+    int                       mCaptureBufferPoolSize;
+    int                       mBurstRingSize;
+    int                       mWatchChangeThreshold;
+    QString                   mImgurUsername;
+    QByteArray                mImgurClientId;
+    QByteArray                mImgurClientSecret;
+    QByteArray                mImgurAccessToken;
+    QByteArray                mImgurRefreshToken;
+    bool                      mImgurForceAnonymous;
+    bool                      mImgurOpenLinkDirectlyToImage;
+    bool                      mImgurAlwaysCopyToClipboard;
+
+    void loadSettings();
+    ImageGrabber::CaptureMode loadCaptureMode() const;
+    void watchSettingsFile();
+    void saveValue(const QString &key, const QVariant &value);
+
+private slots:
+    void reloadSettings();
 };
 
 #endif // KSNIPCONFIG_H
@@ -0,0 +1,343 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "PngEncoder.h"
+
+PngEncoder::PngEncoder() :
+    mCompressionLevel(6),
+    mThreadCount(0)
+{
+}
+
+void PngEncoder::setCompressionLevel(int level)
+{
+    mCompressionLevel = qBound(0, level, 9);
+}
+
+int PngEncoder::compressionLevel() const
+{
+    return mCompressionLevel;
+}
+
+/*
+ * Number of threads used for compressing, zero uses one thread per core.
+ */
+void PngEncoder::setThreadCount(int count)
+{
+    mThreadCount = qMax(0, count);
+}
+
+int PngEncoder::threadCount() const
+{
+    if (mThreadCount > 0) {
+        return mThreadCount;
+    }
+    return qMax(1, QThread::idealThreadCount());
+}
+
+/*
+ * Called on the writing thread after every band that was written, with the
+ * percentage of the image written so far.
+ */
+void PngEncoder::setProgressFunction(const ProgressFunction& function)
+{
+    mProgressFunction = function;
+}
+
+bool PngEncoder::write(const QImage& image, const QString& path) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCritical("PngEncoder::write: Unable to open '%s': %s",
+                  qPrintable(path),
+                  qPrintable(file.errorString()));
+        return false;
+    }
+
+    if (!write(image, &file) || !file.flush()) {
+        qCritical("PngEncoder::write: Unable to write '%s': %s",
+                  qPrintable(path),
+                  qPrintable(file.errorString()));
+        file.remove();
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Writes the image as PNG. The image is split into bands of rows which are
+ * filtered and deflated in parallel, each band ends on a byte boundary via a
+ * sync flush so the compressed bands can be concatenated into a single zlib
+ * stream, the same way pigz does it. Every band is written as soon as it and
+ * all bands before it are done.
+ */
+bool PngEncoder::write(const QImage& image, QIODevice* device) const
+{
+    if (image.isNull()) {
+        return false;
+    }
+
+    auto source = image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32
+                                                                : QImage::Format_RGB32);
+    auto rowSize = source.width() * bytesPerPixel(source) + 1;
+    auto bandRows = rowsPerBand(rowSize, source.height());
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount());
+
+    QList<QFuture<Band>> bands;
+    for (auto row = 0; row < source.height(); row += bandRows) {
+        bands.append(QtConcurrent::run(&pool, this, &PngEncoder::encodeBand,
+                                       source, row, qMin(bandRows, source.height() - row)));
+    }
+
+    static const char signature[] = "\x89PNG\r\n\x1a\n";
+    if (device->write(signature, 8) != 8) {
+        return false;
+    }
+
+    QByteArray header(13, 0);
+    auto headerData = reinterpret_cast<uchar*>(header.data());
+    qToBigEndian<quint32>(source.width(), headerData);
+    qToBigEndian<quint32>(source.height(), headerData + 4);
+    headerData[8] = 8;
+    headerData[9] = source.format() == QImage::Format_ARGB32 ? 6 : 2;
+    if (!writeChunk(device, "IHDR", header) || !writeMetadata(image, device)) {
+        return false;
+    }
+
+    // The zlib header carries the compression level only as a hint for
+    // recompressing, the check bits make it a multiple of 31.
+    auto cmf = 0x78;
+    auto flg = (mCompressionLevel < 2 ? 0 : mCompressionLevel < 6 ? 1 : mCompressionLevel == 6 ? 2 : 3) << 6;
+    flg += 31 - ((cmf << 8) + flg) % 31;
+
+    auto adler = adler32(0L, Z_NULL, 0);
+    for (auto i = 0; i < bands.count(); i++) {
+        auto band = bands[i].result();
+        if (band.data.isEmpty()) {
+            return false;
+        }
+        adler = adler32_combine(adler, band.adler, band.rawSize);
+
+        auto chunk = band.data;
+        if (i == 0) {
+            chunk.prepend(static_cast<char>(flg));
+            chunk.prepend(static_cast<char>(cmf));
+        }
+        if (i == bands.count() - 1) {
+            uchar checksum[4];
+            qToBigEndian<quint32>(adler, checksum);
+            chunk.append(reinterpret_cast<const char*>(checksum), 4);
+        }
+        if (!writeChunk(device, "IDAT", chunk)) {
+            return false;
+        }
+        if (mProgressFunction) {
+            mProgressFunction((i + 1) * 100 / bands.count());
+        }
+    }
+
+    return writeChunk(device, "IEND", QByteArray());
+}
+
+bool PngEncoder::canWrite(const QString& path)
+{
+    return QFileInfo(path).suffix().compare("png", Qt::CaseInsensitive) == 0;
+}
+
+//
+// Private Functions
+//
+
+/*
+ * Bands should be large enough to keep the compression ratio close to the one
+ * of a single stream, but small enough so that every thread gets some work.
+ */
+int PngEncoder::rowsPerBand(int rowSize, int height) const
+{
+    auto rows = qMax(1, mBandSize / rowSize);
+    auto rowsPerThread = (height + threadCount() - 1) / threadCount();
+    return qMax(1, qMin(rows, rowsPerThread));
+}
+
+/*
+ * Runs on a worker thread. All but the last band are ended with a sync flush,
+ * which leaves the stream open and byte aligned, the last one finishes the
+ * stream. The deflater is primed with the data preceding the band so that
+ * matches can still reach across the band border.
+ */
+PngEncoder::Band PngEncoder::encodeBand(const QImage& image, int firstRow, int rowCount) const
+{
+    Band band;
+    auto raw = filterRows(image, firstRow, rowCount);
+    band.rawSize = raw.size();
+    band.adler = adler32(adler32(0L, Z_NULL, 0),
+                         reinterpret_cast<const Bytef*>(raw.constData()),
+                         raw.size());
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, mCompressionLevel, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        qCritical("PngEncoder::encodeBand: Unable to initialize deflate");
+        return band;
+    }
+
+    if (firstRow > 0) {
+        auto rowSize = raw.size() / rowCount;
+        auto dictionaryRows = qMin(firstRow, (mWindowSize + rowSize - 1) / rowSize);
+        auto dictionary = filterRows(image, firstRow - dictionaryRows, dictionaryRows).right(mWindowSize);
+        deflateSetDictionary(&stream,
+                             reinterpret_cast<const Bytef*>(dictionary.constData()),
+                             dictionary.size());
+    }
+
+    // The bound covers a finished stream, the sync flush marker needs a few
+    // bytes on top of that.
+    auto isLast = firstRow + rowCount == image.height();
+    band.data.resize(deflateBound(&stream, raw.size()) + 16);
+
+    stream.next_in = reinterpret_cast<Bytef*>(raw.data());
+    stream.avail_in = raw.size();
+    stream.next_out = reinterpret_cast<Bytef*>(band.data.data());
+    stream.avail_out = band.data.size();
+
+    auto result = deflate(&stream, isLast ? Z_FINISH : Z_SYNC_FLUSH);
+    if ((isLast && result != Z_STREAM_END) || (!isLast && result != Z_OK) || stream.avail_in != 0) {
+        qCritical("PngEncoder::encodeBand: Deflate failed for rows %d to %d",
+                  firstRow,
+                  firstRow + rowCount - 1);
+        band.data.clear();
+    } else {
+        band.data.resize(band.data.size() - stream.avail_out);
+    }
+
+    deflateEnd(&stream);
+    return band;
+}
+
+/*
+ * Converts the rows into PNG scanlines, each prefixed with the filter that
+ * suits it best. The choice only depends on the row and the one above, so
+ * filtering the same rows again always gives the same result.
+ */
+QByteArray PngEncoder::filterRows(const QImage& image, int firstRow, int rowCount)
+{
+    auto rowSize = image.width() * bytesPerPixel(image);
+    QByteArray rows((rowSize + 1) * rowCount, Qt::Uninitialized);
+    QByteArray packed[2] = { QByteArray(rowSize, Qt::Uninitialized), QByteArray(rowSize, Qt::Uninitialized) };
+    auto current = reinterpret_cast<uchar*>(packed[0].data());
+    auto previous = reinterpret_cast<uchar*>(packed[1].data());
+
+    if (firstRow > 0) {
+        packRow(image, firstRow - 1, previous);
+    }
+
+    PngRowFilter filter(rowSize, bytesPerPixel(image));
+    auto out = reinterpret_cast<uchar*>(rows.data());
+    for (auto row = firstRow; row < firstRow + rowCount; row++) {
+        packRow(image, row, current);
+        filter.filter(current, row > 0 ? previous : nullptr, out);
+        qSwap(current, previous);
+        out += rowSize + 1;
+    }
+    return rows;
+}
+
+void PngEncoder::packRow(const QImage& image, int row, uchar* out)
+{
+    auto pixels = reinterpret_cast<const QRgb*>(image.constScanLine(row));
+    auto hasAlpha = image.format() == QImage::Format_ARGB32;
+    for (auto x = 0; x < image.width(); x++) {
+        *out++ = qRed(pixels[x]);
+        *out++ = qGreen(pixels[x]);
+        *out++ = qBlue(pixels[x]);
+        if (hasAlpha) {
+            *out++ = qAlpha(pixels[x]);
+        }
+    }
+}
+
+int PngEncoder::bytesPerPixel(const QImage& image)
+{
+    return image.format() == QImage::Format_ARGB32 ? 4 : 3;
+}
+
+/*
+ * Writes the resolution and the text of the image the same way QImageWriter
+ * does. Text that fits into Latin-1 goes into tEXt chunks, any other text into
+ * uncompressed iTXt chunks holding UTF-8.
+ */
+bool PngEncoder::writeMetadata(const QImage& image, QIODevice* device)
+{
+    if (image.dotsPerMeterX() > 0 || image.dotsPerMeterY() > 0) {
+        QByteArray physical(9, 0);
+        auto physicalData = reinterpret_cast<uchar*>(physical.data());
+        qToBigEndian<quint32>(qMax(0, image.dotsPerMeterX()), physicalData);
+        qToBigEndian<quint32>(qMax(0, image.dotsPerMeterY()), physicalData + 4);
+        physicalData[8] = 1;
+        if (!writeChunk(device, "pHYs", physical)) {
+            return false;
+        }
+    }
+
+    for (const auto& key : image.textKeys()) {
+        auto keyword = key.toLatin1();
+        if (keyword.isEmpty() || keyword.size() > 79 || QString::fromLatin1(keyword) != key) {
+            qWarning("PngEncoder::writeMetadata: Skipping invalid text key '%s'", qPrintable(key));
+            continue;
+        }
+
+        auto text = image.text(key);
+        auto latin1Text = text.toLatin1();
+        QByteArray chunk = keyword;
+        chunk.append('\0');
+        if (QString::fromLatin1(latin1Text) == text) {
+            chunk.append(latin1Text);
+            if (!writeChunk(device, "tEXt", chunk)) {
+                return false;
+            }
+        } else {
+            // No compression, no language tag and no translated keyword
+            chunk.append(QByteArray(4, 0));
+            chunk.append(text.toUtf8());
+            if (!writeChunk(device, "iTXt", chunk)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool PngEncoder::writeChunk(QIODevice* device, const char* type, const QByteArray& data)
+{
+    uchar length[4];
+    qToBigEndian<quint32>(data.size(), length);
+
+    auto crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(type), 4);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(data.constData()), data.size());
+    uchar checksum[4];
+    qToBigEndian<quint32>(crc, checksum);
+
+    return device->write(reinterpret_cast<const char*>(length), 4) == 4
+           && device->write(type, 4) == 4
+           && device->write(data) == data.size()
+           && device->write(reinterpret_cast<const char*>(checksum), 4) == 4;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef PNGENCODER_H
+#define PNGENCODER_H
+
+#include <zlib.h>
+
+#include <QImage>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QThreadPool>
+#include <QFuture>
+#include <QtConcurrent>
+#include <QtEndian>
+
+#include <functional>
+
+#include "PngRowFilter.h"
+
+class PngEncoder
+{
+public:
+    typedef std::function<void(int percent)> ProgressFunction;
+
+public:
+    PngEncoder();
+    void setCompressionLevel(int level);
+    int compressionLevel() const;
+    void setThreadCount(int count);
+    int threadCount() const;
+    void setProgressFunction(const ProgressFunction &function);
+    bool write(const QImage &image, const QString &path) const;
+    bool write(const QImage &image, QIODevice *device) const;
+    static bool canWrite(const QString &path);
+
+private:
+    struct Band {
+        QByteArray data;
+        uLong      adler;
+        qint64     rawSize;
+    };
+
+    int              mCompressionLevel;
+    int              mThreadCount;
+    ProgressFunction mProgressFunction;
+    const int        mBandSize = 1024 * 1024;
+    const int        mWindowSize = 32768;
+
+    int rowsPerBand(int rowSize, int height) const;
+    Band encodeBand(const QImage &image, int firstRow, int rowCount) const;
+    static QByteArray filterRows(const QImage &image, int firstRow, int rowCount);
+    static void packRow(const QImage &image, int row, uchar *out);
+    static int bytesPerPixel(const QImage &image);
+    static bool writeMetadata(const QImage &image, QIODevice *device);
+    static bool writeChunk(QIODevice *device, const char *type, const QByteArray &data);
+};
+
+#endif // PNGENCODER_H
@@ -0,0 +1,431 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "PngRowFilter.h"
+
+namespace {
+
+//
+// Scalar kernels, also used for the head and tail of the vectorized ones.
+// All kernels write the filtered bytes from start to end and return the sum
+// of the filtered bytes interpreted as signed values, the usual heuristic for
+// picking the filter that compresses best.
+//
+
+inline quint64 score(uchar value)
+{
+    return value < 128 ? value : 256 - value;
+}
+
+quint64 noneScalar(const uchar *row, const uchar *, int start, int end, int, uchar *out)
+{
+    quint64 sum = 0;
+    for (auto i = start; i < end; i++) {
+        out[i] = row[i];
+        sum += score(out[i]);
+    }
+    return sum;
+}
+
+quint64 subScalar(const uchar *row, const uchar *, int start, int end, int bpp, uchar *out)
+{
+    quint64 sum = 0;
+    for (auto i = start; i < end; i++) {
+        auto left = i >= bpp ? row[i - bpp] : 0;
+        out[i] = row[i] - left;
+        sum += score(out[i]);
+    }
+    return sum;
+}
+
+quint64 upScalar(const uchar *row, const uchar *previous, int start, int end, int, uchar *out)
+{
+    quint64 sum = 0;
+    for (auto i = start; i < end; i++) {
+        out[i] = row[i] - previous[i];
+        sum += score(out[i]);
+    }
+    return sum;
+}
+
+quint64 averageScalar(const uchar *row, const uchar *previous, int start, int end, int bpp, uchar *out)
+{
+    quint64 sum = 0;
+    for (auto i = start; i < end; i++) {
+        auto left = i >= bpp ? row[i - bpp] : 0;
+        out[i] = row[i] - ((left + previous[i]) >> 1);
+        sum += score(out[i]);
+    }
+    return sum;
+}
+
+quint64 paethScalar(const uchar *row, const uchar *previous, int start, int end, int bpp, uchar *out)
+{
+    quint64 sum = 0;
+    for (auto i = start; i < end; i++) {
+        int a = i >= bpp ? row[i - bpp] : 0;
+        int b = previous[i];
+        int c = i >= bpp ? previous[i - bpp] : 0;
+        auto pa = qAbs(b - c);
+        auto pb = qAbs(a - c);
+        auto pc = qAbs(a + b - 2 * c);
+        auto predictor = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+        out[i] = row[i] - predictor;
+        sum += score(out[i]);
+    }
+    return sum;
+}
+
+template<quint64 (*scalar)(const uchar *, const uchar *, int, int, int, uchar *)>
+quint64 wholeRow(const uchar *row, const uchar *previous, int size, int bpp, uchar *out)
+{
+    return scalar(row, previous, 0, size, bpp, out);
+}
+
+#ifdef KSNIP_X86_FILTERS
+
+//
+// SSE2 kernels, 16 bytes per iteration. Bytes before bpp have no left
+// neighbour and are left to the scalar kernels.
+//
+
+__attribute__((target("sse2")))
+inline __m128i scoreSse2(__m128i filtered, __m128i sum)
+{
+    auto zero = _mm_setzero_si128();
+    auto absolute = _mm_min_epu8(filtered, _mm_sub_epi8(zero, filtered));
+    return _mm_add_epi64(sum, _mm_sad_epu8(absolute, zero));
+}
+
+__attribute__((target("sse2")))
+inline quint64 sumSse2(__m128i sum)
+{
+    quint64 halves[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(halves), sum);
+    return halves[0] + halves[1];
+}
+
+__attribute__((target("sse2")))
+quint64 noneSse2(const uchar *row, const uchar *previous, int size, int bpp, uchar *out)
+{
+    auto sum = _mm_setzero_si128();
+    auto i = 0;
+    for (; i + 16 <= size; i += 16) {
+        auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), x);
+        sum = scoreSse2(x, sum);
+    }
+    return sumSse2(sum) + noneScalar(row, previous, i, size, bpp, out);
+}
+
+__attribute__((target("sse2")))
+quint64 subSse2(const uchar *row, const uchar *previous, int size, int bpp, uchar *out)
+{
+    auto sum = _mm_setzero_si128();
+    auto i = qMin(bpp, size);
+    quint64 head = subScalar(row, previous, 0, i, bpp, out);
+    for (; i + 16 <= size; i += 16) {
+        auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i - bpp));
+        auto filtered = _mm_sub_epi8(x, a);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), filtered);
+        sum = scoreSse2(filtered, sum);
+    }
+    return head + sumSse2(sum) + subScalar(row, previous, i, size, bpp, out);
+}
+
+__attribute__((target("sse2")))
+quint64 upSse2(const uchar *row, const uchar *previous, int size, int bpp, uchar *out)
+{
+    auto sum = _mm_setzero_si128();
+    auto i = 0;
+    for (; i + 16 <= size; i += 16) {
+        auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + i));
+        auto filtered = _mm_sub_epi8(x, b);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), filtered);
+        sum = scoreSse2(filtered, sum);
+    }
+    return sumSse2(sum) + upScalar(row, previous, i, size, bpp, out);
+}
+
+__attribute__((target("sse2")))
+quint64 averageSse2(const uchar *row, const uchar *previous, int size, int bpp, uchar *out)
+{
+    auto sum = _mm_setzero_si128();
+    auto one = _mm_set1_epi8(1);
+    auto i = qMin(bpp, size);
+    quint64 head = averageScalar(row, previous, 0, i, bpp, out);
+    for (; i + 16 <= size; i += 16) {
+        auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i - bpp));
+        auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + i));
+        // The average instruction rounds up, PNG wants it rounded down
+        auto average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+        auto filtered = _mm_sub_epi8(x, average);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), filtered);
+        sum = scoreSse2(filtered, sum);
+    }
+    return head + sumSse2(sum) + averageScalar(row, previous, i, size, bpp, out);
+}
+
+__attribute__((target("sse2")))
+inline __m128i absSse2(__m128i value)
+{
+    return _mm_max_epi16(value, _mm_sub_epi16(_mm_setzero_si128(), value));
+}
+
+/*
+ * Paeth predictor for eight bytes widened to 16 bit.
+ */
+__attribute__((target("sse2")))
+inline __m128i paethPredictorSse2(__m128i a, __m128i b, __m128i c)
+{
+    auto pa = absSse2(_mm_sub_epi16(b, c));
+    auto pb = absSse2(_mm_sub_epi16(a, c));
+    auto pc = absSse2(_mm_add_epi16(_mm_sub_epi16(b, c), _mm_sub_epi16(a, c)));
+    auto notA = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+    auto notB = _mm_cmpgt_epi16(pb, pc);
+    auto bOrC = _mm_or_si128(_mm_andnot_si128(notB, b), _mm_and_si128(notB, c));
+    return _mm_or_si128(_mm_andnot_si128(notA, a), _mm_and_si128(notA, bOrC));
+}
+
+__attribute__((target("sse2")))
+quint64 paethSse2(const uchar *row, const uchar *previous, int size, int bpp, uchar *out)
+{
+    auto sum = _mm_setzero_si128();
+    auto zero = _mm_setzero_si128();
+    auto i = qMin(bpp, size);
+    quint64 head = paethScalar(row, previous, 0, i, bpp, out);
+    for (; i + 16 <= size; i += 16) {
+        auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i - bpp));
+        auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + i));
+        auto c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + i - bpp));
+        auto low = paethPredictorSse2(_mm_unpacklo_epi8(a, zero),
+                                      _mm_unpacklo_epi8(b, zero),
+                                      _mm_unpacklo_epi8(c, zero));
+        auto high = paethPredictorSse2(_mm_unpackhi_epi8(a, zero),
+                                       _mm_unpackhi_epi8(b, zero),
+                                       _mm_unpackhi_epi8(c, zero));
+        // The predictor is one of the input bytes, packing can't saturate
+        auto filtered = _mm_sub_epi8(x, _mm_packus_epi16(low, high));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), filtered);
+        sum = scoreSse2(filtered, sum);
+    }
+    return head + sumSse2(sum) + paethScalar(row, previous, i, size, bpp, out);
+}
+
+//
+// AVX2 kernels, same as the SSE2 ones with 32 bytes per iteration. Paeth works
+// on 16 bytes widened into one register.
+//
+
+__attribute__((target("avx2")))
+inline __m256i scoreAvx2(__m256i filtered, __m256i sum)
+{
+    return _mm256_add_epi64(sum, _mm256_sad_epu8(_mm256_abs_epi8(filtered), _mm256_setzero_si256()));
+}
+
+__attribute__((target("avx2")))
+inline quint64 sumAvx2(__m256i sum)
+{
+    quint64 quarters[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(quarters), sum);
+    return quarters[0] + quarters[1] + quarters[2] + quarters[3];
+}
+
+__attribute__((target("avx2")))
+quint64 noneAvx2(const uchar *row, const uchar *previous, int size, int bpp, uchar *out)
+{
+    auto sum = _mm256_setzero_si256();
+    auto i = 0;
+    for (; i + 32 <= size; i += 32) {
+        auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), x);
+        sum = scoreAvx2(x, sum);
+    }
+    return sumAvx2(sum) + noneScalar(row, previous, i, size, bpp, out);
+}
+
+__attribute__((target("avx2")))
+quint64 subAvx2(const uchar *row, const uchar *previous, int size, int bpp, uchar *out)
+{
+    auto sum = _mm256_setzero_si256();
+    auto i = qMin(bpp, size);
+    quint64 head = subScalar(row, previous, 0, i, bpp, out);
+    for (; i + 32 <= size; i += 32) {
+        auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+        auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i - bpp));
+        auto filtered = _mm256_sub_epi8(x, a);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), filtered);
+        sum = scoreAvx2(filtered, sum);
+    }
+    return head + sumAvx2(sum) + subScalar(row, previous, i, size, bpp, out);
+}
+
+__attribute__((target("avx2")))
+quint64 upAvx2(const uchar *row, const uchar *previous, int size, int bpp, uchar *out)
+{
+    auto sum = _mm256_setzero_si256();
+    auto i = 0;
+    for (; i + 32 <= size; i += 32) {
+        auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+        auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(previous + i));
+        auto filtered = _mm256_sub_epi8(x, b);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), filtered);
+        sum = scoreAvx2(filtered, sum);
+    }
+    return sumAvx2(sum) + upScalar(row, previous, i, size, bpp, out);
+}
+
+__attribute__((target("avx2")))
+quint64 averageAvx2(const uchar *row, const uchar *previous, int size, int bpp, uchar *out)
+{
+    auto sum = _mm256_setzero_si256();
+    auto one = _mm256_set1_epi8(1);
+    auto i = qMin(bpp, size);
+    quint64 head = averageScalar(row, previous, 0, i, bpp, out);
+    for (; i + 32 <= size; i += 32) {
+        auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+        auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i - bpp));
+        auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(previous + i));
+        auto average = _mm256_sub_epi8(_mm256_avg_epu8(a, b),
+                                       _mm256_and_si256(_mm256_xor_si256(a, b), one));
+        auto filtered = _mm256_sub_epi8(x, average);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), filtered);
+        sum = scoreAvx2(filtered, sum);
+    }
+    return head + sumAvx2(sum) + averageScalar(row, previous, i, size, bpp, out);
+}
+
+__attribute__((target("avx2")))
+quint64 paethAvx2(const uchar *row, const uchar *previous, int size, int bpp, uchar *out)
+{
+    // Only 16 filtered bytes per iteration, scored with the 128 bit SAD so no
+    // undefined upper half of a widened register ends up in the score.
+    auto sum = _mm_setzero_si128();
+    auto i = qMin(bpp, size);
+    quint64 head = paethScalar(row, previous, 0, i, bpp, out);
+    for (; i + 16 <= size; i += 16) {
+        auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        auto a = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i - bpp)));
+        auto b = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + i)));
+        auto c = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + i - bpp)));
+        auto pa = _mm256_abs_epi16(_mm256_sub_epi16(b, c));
+        auto pb = _mm256_abs_epi16(_mm256_sub_epi16(a, c));
+        auto pc = _mm256_abs_epi16(_mm256_add_epi16(_mm256_sub_epi16(b, c), _mm256_sub_epi16(a, c)));
+        auto notA = _mm256_or_si256(_mm256_cmpgt_epi16(pa, pb), _mm256_cmpgt_epi16(pa, pc));
+        auto notB = _mm256_cmpgt_epi16(pb, pc);
+        auto predictor = _mm256_blendv_epi8(a, _mm256_blendv_epi8(b, c, notB), notA);
+        auto packed = _mm_packus_epi16(_mm256_castsi256_si128(predictor),
+                                       _mm256_extracti128_si256(predictor, 1));
+        auto filtered = _mm_sub_epi8(x, packed);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), filtered);
+        sum = scoreSse2(filtered, sum);
+    }
+    return head + sumSse2(sum) + paethScalar(row, previous, i, size, bpp, out);
+}
+
+#endif // KSNIP_X86_FILTERS
+
+}
+
+PngRowFilter::PngRowFilter(int rowSize, int bytesPerPixel) :
+    mRowSize(rowSize),
+    mBytesPerPixel(bytesPerPixel),
+    mZeroRow(rowSize, 0)
+{
+    mCandidates[0].resize(rowSize);
+    mCandidates[1].resize(rowSize);
+}
+
+/*
+ * Filters the row with every filter type and writes the type byte followed by
+ * the result with the smallest sum of absolute values into out, which must
+ * hold one byte more than the row. Previous is the unfiltered row above, null
+ * for the first row of the image.
+ */
+PngRowFilter::Type PngRowFilter::filter(const uchar* row, const uchar* previous, uchar* out)
+{
+    if (!previous) {
+        previous = reinterpret_cast<const uchar*>(mZeroRow.constData());
+    }
+
+    auto best = reinterpret_cast<uchar*>(mCandidates[0].data());
+    auto trial = reinterpret_cast<uchar*>(mCandidates[1].data());
+    auto bestType = None;
+    auto bestScore = std::numeric_limits<quint64>::max();
+
+    const auto &filters = kernels().filters;
+    for (auto type = None; type <= Paeth; type = static_cast<Type>(type + 1)) {
+        auto score = filters[type](row, previous, mRowSize, mBytesPerPixel, trial);
+        if (score < bestScore) {
+            bestScore = score;
+            bestType = type;
+            qSwap(best, trial);
+        }
+    }
+
+    out[0] = bestType;
+    memcpy(out + 1, best, mRowSize);
+    return bestType;
+}
+
+/*
+ * Name of the kernels picked for this CPU.
+ */
+QString PngRowFilter::implementation()
+{
+    return QString::fromLatin1(kernels().name);
+}
+
+//
+// Private Functions
+//
+
+/*
+ * The kernels are picked once at runtime based on what the CPU supports, so
+ * the same binary runs on machines without AVX2.
+ */
+const PngRowFilter::Kernels& PngRowFilter::kernels()
+{
+    static const Kernels scalar = {
+        "scalar",
+        { wholeRow<noneScalar>, wholeRow<subScalar>, wholeRow<upScalar>,
+          wholeRow<averageScalar>, wholeRow<paethScalar> }
+    };
+
+#ifdef KSNIP_X86_FILTERS
+    static const Kernels sse2 = {
+        "sse2",
+        { noneSse2, subSse2, upSse2, averageSse2, paethSse2 }
+    };
+    static const Kernels avx2 = {
+        "avx2",
+        { noneAvx2, subAvx2, upAvx2, averageAvx2, paethAvx2 }
+    };
+
+    static const Kernels &selected = __builtin_cpu_supports("avx2") ? avx2 :
+                                     __builtin_cpu_supports("sse2") ? sse2 : scalar;
+    return selected;
+#else
+    return scalar;
+#endif
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef PNGROWFILTER_H
+#define PNGROWFILTER_H
+
+#include <QByteArray>
+#include <QString>
+
+#include <cstring>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KSNIP_X86_FILTERS
+#include <immintrin.h>
+#endif
+
+class PngRowFilter
+{
+public:
+    enum Type {
+        None,
+        Sub,
+        Up,
+        Average,
+        Paeth
+    };
+
+public:
+    PngRowFilter(int rowSize, int bytesPerPixel);
+    Type filter(const uchar *row, const uchar *previous, uchar *out);
+    static QString implementation();
+
+private:
+    typedef quint64 (*Kernel)(const uchar *row, const uchar *previous, int size, int bpp, uchar *out);
+
+    struct Kernels {
+        const char *name;
+        Kernel      filters[5];
+    };
+
+    int        mRowSize;
+    int        mBytesPerPixel;
+    QByteArray mCandidates[2];
+    QByteArray mZeroRow;
+
+    static const Kernels &kernels();
+};
+
+#endif // PNGROWFILTER_H
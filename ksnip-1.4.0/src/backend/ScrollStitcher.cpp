@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "ScrollStitcher.h"
+
+ScrollStitcher::ScrollStitcher() :
+    mWidth(0),
+    mHeight(0),
+    mBytesPerLine(0),
+    mTailRows(0)
+{
+}
+
+/*
+ * Rows at the top and bottom that didn't change, like toolbars, title and
+ * status bars, are left out when looking for the scroll distance. The bottom
+ * ones are kept at the end of the output and moved down with every frame.
+ * Returns false when the frame didn't add anything.
+ */
+bool ScrollStitcher::addFrame(const QImage& frame)
+{
+    auto image = frame.convertToFormat(QImage::Format_RGB32);
+    auto hashes = rowHashes(image);
+
+    if (mPreviousHashes.isEmpty()) {
+        mWidth = image.width();
+        mBytesPerLine = mWidth * 4;
+        appendRows(image, 0, image.height());
+        mTailRows = image.height();
+        mPreviousHashes = hashes;
+        return true;
+    }
+
+    if (image.width() != mWidth || hashes.count() != mPreviousHashes.count()) {
+        qWarning("ScrollStitcher::addFrame: Frame size changed, ignoring frame.");
+        return false;
+    }
+
+    auto height = hashes.count();
+    auto top = 0;
+    while (top < height && hashes[top] == mPreviousHashes[top]) {
+        top++;
+    }
+    if (top == height) {
+        return false;
+    }
+
+    auto bottom = 0;
+    while (bottom < height - top && hashes[height - 1 - bottom] == mPreviousHashes[height - 1 - bottom]) {
+        bottom++;
+    }
+    auto end = height - bottom;
+
+    auto scroll = findScroll(mPreviousHashes, hashes, top, end);
+    mPreviousHashes = hashes;
+
+    // Changed but not scrolled, like a blinking cursor
+    if (scroll == 0) {
+        return false;
+    }
+
+    // Scrolled further than a frame, there is no overlap we could use
+    if (scroll < 0) {
+        qWarning("ScrollStitcher::addFrame: Found no overlap with previous frame, scrolled too fast?");
+        scroll = end - top;
+    }
+
+    removeRows(qMin(bottom, mTailRows));
+    appendRows(image, end - scroll, scroll);
+    appendRows(image, end, bottom);
+    mTailRows = scroll + bottom;
+    return true;
+}
+
+/*
+ * The image shares the pixels with the stitcher and is read only, writing to
+ * it detaches.
+ */
+QImage ScrollStitcher::result() const
+{
+    if (mHeight == 0) {
+        return QImage();
+    }
+
+    auto pixels = new QByteArray(mPixels);
+    return QImage((const uchar*)pixels->constData(),
+                  mWidth,
+                  mHeight,
+                  mBytesPerLine,
+                  QImage::Format_RGB32,
+                  &ScrollStitcher::releasePixels,
+                  pixels);
+}
+
+//
+// Private Functions
+//
+
+QVector<uint> ScrollStitcher::rowHashes(const QImage& frame)
+{
+    QVector<uint> hashes(frame.height());
+    auto rowSize = frame.width() * 4;
+    for (auto y = 0; y < frame.height(); y++) {
+        hashes[y] = qHashBits(frame.constScanLine(y), rowSize);
+    }
+    return hashes;
+}
+
+/*
+ * Returns by how many rows the content between top and end moved up, zero if
+ * it didn't move and -1 if no overlap was found. The first rows of the current
+ * frame are searched in the previous frame with a rolling hash over the row
+ * hashes, a match is only taken when the whole overlap is equal.
+ */
+int ScrollStitcher::findScroll(const QVector<uint>& previous, const QVector<uint>& current, int top, int end) const
+{
+    auto length = end - top;
+    auto patternRows = qMin(mPatternRows, length / 2);
+    if (patternRows < 1) {
+        return -1;
+    }
+
+    if (std::equal(previous.begin() + top, previous.begin() + end, current.begin() + top)) {
+        return 0;
+    }
+
+    const quint64 base = 1000003;
+    quint64 highestPower = 1;
+    quint64 patternHash = 0;
+    quint64 windowHash = 0;
+    for (auto i = 0; i < patternRows; i++) {
+        if (i > 0) {
+            highestPower *= base;
+        }
+        patternHash = patternHash * base + current[top + i];
+        windowHash = windowHash * base + previous[top + i];
+    }
+
+    for (auto scroll = 1; scroll <= length - patternRows; scroll++) {
+        windowHash = (windowHash - previous[top + scroll - 1] * highestPower) * base
+                     + previous[top + scroll + patternRows - 1];
+
+        if (windowHash == patternHash &&
+                std::equal(previous.begin() + top + scroll, previous.begin() + end, current.begin() + top)) {
+            return scroll;
+        }
+    }
+    return -1;
+}
+
+void ScrollStitcher::appendRows(const QImage& frame, int first, int count)
+{
+    for (auto y = first; y < first + count; y++) {
+        mPixels.append((const char*)frame.constScanLine(y), mBytesPerLine);
+    }
+    mHeight += count;
+}
+
+void ScrollStitcher::removeRows(int count)
+{
+    mPixels.chop(count * mBytesPerLine);
+    mHeight -= count;
+}
+
+void ScrollStitcher::releasePixels(void* pixels)
+{
+    delete static_cast<QByteArray*>(pixels);
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef SCROLLSTITCHER_H
+#define SCROLLSTITCHER_H
+
+#include <QImage>
+#include <QVector>
+#include <QByteArray>
+#include <QHash>
+
+/*
+ * Stitches successive grabs of a scrolled window into one tall image. Frames
+ * are compared by hashes of their rows, only the rows that scrolled into view
+ * are appended to the output, so memory is bound by the output and the hashes
+ * of the previous frame.
+ */
+class ScrollStitcher
+{
+public:
+    ScrollStitcher();
+    bool addFrame(const QImage &frame);
+    QImage result() const;
+
+private:
+    QByteArray    mPixels;
+    int           mWidth;
+    int           mHeight;
+    int           mBytesPerLine;
+    int           mTailRows;
+    QVector<uint> mPreviousHashes;
+    const int     mPatternRows = 32;
+
+    static QVector<uint> rowHashes(const QImage &frame);
+    int findScroll(const QVector<uint> &previous, const QVector<uint> &current, int top, int end) const;
+    void appendRows(const QImage &frame, int first, int count);
+    void removeRows(int count);
+    static void releasePixels(void *pixels);
+};
+
+#endif // SCROLLSTITCHER_H
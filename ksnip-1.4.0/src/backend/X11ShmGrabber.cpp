@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "X11ShmGrabber.h"
+
+QMutex X11ShmGrabber::mOwnerMutex;
+
+X11ShmGrabber::X11ShmGrabber() :
+    mPoolSize(0),
+    mPoolLimit(0)
+{
+    mIsAvailable = isServerSupported() && isPixmapFormatSupported();
+}
+
+/*
+ * Segments still wrapped by images are handed over to those images, they are
+ * destroyed as soon as the image is released.
+ */
+X11ShmGrabber::~X11ShmGrabber()
+{
+    QMutexLocker ownerLocker(&mOwnerMutex);
+    QMutexLocker locker(&mMutex);
+    for (auto segment : mSegments) {
+        if (segment->inUse) {
+            segment->owner = nullptr;
+        } else {
+            destroySegment(segment);
+        }
+    }
+    mSegments.clear();
+}
+
+bool X11ShmGrabber::isAvailable() const
+{
+    return mIsAvailable;
+}
+
+/*
+ * Grabs the rect of the root window into a shared memory segment and returns
+ * an image that wraps the segment without copying it. Segments are kept in a
+ * pool after the image was released, so back to back grabs of the same size
+ * reuse memory that is already mapped and attached on the server. Returns a
+ * null image if the grab was not possible, the caller is then expected to
+ * fall back to a regular grab.
+ */
+QImage X11ShmGrabber::grabRect(const QRect& rect)
+{
+    if (!mIsAvailable || rect.isEmpty()) {
+        return QImage();
+    }
+
+    auto segment = acquireSegment(rect.size());
+    if (!segment) {
+        return QImage();
+    }
+
+    auto connection = QX11Info::connection();
+    auto imageCookie = xcb_shm_get_image_unchecked(connection,
+                                                   QX11Info::appRootWindow(),
+                                                   rect.x(),
+                                                   rect.y(),
+                                                   rect.width(),
+                                                   rect.height(),
+                                                   ~0,
+                                                   XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                                   segment->id,
+                                                   0);
+    ScopedCPointer<xcb_shm_get_image_reply_t> imageReply(xcb_shm_get_image_reply(connection, imageCookie, nullptr));
+
+    if (imageReply.isNull()) {
+        returnSegment(segment);
+        return QImage();
+    }
+
+    return QImage(segment->data,
+                  rect.width(),
+                  rect.height(),
+                  rect.width() * 4,
+                  QImage::Format_RGB32,
+                  &X11ShmGrabber::releaseSegment,
+                  segment);
+}
+
+/*
+ * Sets how many bytes of unused capture buffers may be kept for reuse. Zero
+ * disables pooling, buffers are then freed as soon as they are released.
+ */
+void X11ShmGrabber::setPoolLimit(qint64 bytes)
+{
+    QMutexLocker locker(&mMutex);
+    mPoolLimit = qMax(bytes, (qint64)0);
+    trimPool(0);
+}
+
+qint64 X11ShmGrabber::poolSize() const
+{
+    QMutexLocker locker(&mMutex);
+    return mPoolSize;
+}
+
+X11ShmGrabber::Segment* X11ShmGrabber::acquireSegment(const QSize& size)
+{
+    QMutexLocker locker(&mMutex);
+    for (auto segment : mSegments) {
+        if (!segment->inUse && segment->size == size) {
+            segment->inUse = true;
+            // Move to the end, trimming drops least recently used first
+            mSegments.removeOne(segment);
+            mSegments.append(segment);
+            return segment;
+        }
+    }
+
+    trimPool((qint64)size.width() * size.height() * 4);
+    auto segment = createSegment(size);
+    if (segment) {
+        segment->inUse = true;
+        mSegments.append(segment);
+        mPoolSize += segment->byteCount;
+    }
+    return segment;
+}
+
+/*
+ * Creates a new segment and attaches it on the X server. When attaching fails,
+ * like it does for remote X servers, the grabber disables itself.
+ */
+X11ShmGrabber::Segment* X11ShmGrabber::createSegment(const QSize& size)
+{
+    auto byteCount = (qint64)size.width() * size.height() * 4;
+    auto shmId = shmget(IPC_PRIVATE, byteCount, IPC_CREAT | 0600);
+    if (shmId < 0) {
+        qWarning("X11ShmGrabber::createSegment: Unable to create shared memory segment.");
+        return nullptr;
+    }
+
+    auto data = shmat(shmId, nullptr, 0);
+    if (data == (void*) -1) {
+        shmctl(shmId, IPC_RMID, nullptr);
+        qWarning("X11ShmGrabber::createSegment: Unable to attach shared memory segment.");
+        return nullptr;
+    }
+
+    auto connection = QX11Info::connection();
+    auto segmentId = xcb_generate_id(connection);
+    ScopedCPointer<xcb_generic_error_t> attachError(xcb_request_check(connection, xcb_shm_attach_checked(connection, segmentId, shmId, false)));
+
+    // Segment stays alive until both we and the X server have detached it
+    shmctl(shmId, IPC_RMID, nullptr);
+
+    if (!attachError.isNull()) {
+        shmdt(data);
+        mIsAvailable = false;
+        qWarning("X11ShmGrabber::createSegment: X server unable to attach shared memory, falling back.");
+        return nullptr;
+    }
+
+    auto segment = new Segment;
+    segment->owner = this;
+    segment->id = segmentId;
+    segment->data = static_cast<uchar*>(data);
+    segment->size = size;
+    segment->byteCount = byteCount;
+    segment->inUse = false;
+    return segment;
+}
+
+void X11ShmGrabber::returnSegment(Segment* segment)
+{
+    QMutexLocker locker(&mMutex);
+    segment->inUse = false;
+    trimPool(0);
+}
+
+/*
+ * Frees unused segments, least recently used first, until the pool together
+ * with the required bytes fits the limit. Segments in use are never freed.
+ */
+void X11ShmGrabber::trimPool(qint64 requiredBytes)
+{
+    for (auto i = 0; i < mSegments.count() && mPoolSize + requiredBytes > mPoolLimit; ) {
+        auto segment = mSegments.at(i);
+        if (segment->inUse) {
+            i++;
+            continue;
+        }
+        mPoolSize -= segment->byteCount;
+        mSegments.removeAt(i);
+        destroySegment(segment);
+    }
+}
+
+void X11ShmGrabber::destroySegment(Segment* segment)
+{
+    auto connection = QX11Info::connection();
+    if (connection) {
+        xcb_shm_detach(connection, segment->id);
+        xcb_flush(connection);
+    }
+    shmdt(segment->data);
+    delete segment;
+}
+
+/*
+ * Cleanup function of the images wrapping a segment, hands the segment back
+ * to the pool or destroys it if the grabber is already gone. Images can be
+ * released on any thread, the owner mutex keeps the grabber from being
+ * destroyed between checking and using it. It can't be the mutex of the
+ * grabber, which goes away with the grabber.
+ */
+void X11ShmGrabber::releaseSegment(void* info)
+{
+    auto segment = static_cast<Segment*>(info);
+    QMutexLocker locker(&mOwnerMutex);
+    if (segment->owner) {
+        segment->owner->returnSegment(segment);
+    } else {
+        destroySegment(segment);
+    }
+}
+
+bool X11ShmGrabber::isServerSupported() const
+{
+    auto connection = QX11Info::connection();
+    if (!connection) {
+        return false;
+    }
+
+    // Rects are passed in device pixels, with scaling they would not match
+    // what the regular grab path expects.
+    if (qGuiApp->devicePixelRatio() != 1) {
+        return false;
+    }
+
+    auto extension = xcb_get_extension_data(connection, &xcb_shm_id);
+    if (!extension || !extension->present) {
+        return false;
+    }
+
+    auto versionCookie = xcb_shm_query_version(connection);
+    ScopedCPointer<xcb_shm_query_version_reply_t> versionReply(xcb_shm_query_version_reply(connection, versionCookie, nullptr));
+    return !versionReply.isNull();
+}
+
+/*
+ * The image is wrapped as Format_RGB32, which requires 32 bits per pixel in
+ * little endian order for the root window depth.
+ */
+bool X11ShmGrabber::isPixmapFormatSupported() const
+{
+    auto setup = xcb_get_setup(QX11Info::connection());
+    if (setup->image_byte_order != XCB_IMAGE_ORDER_LSB_FIRST
+            || QSysInfo::ByteOrder != QSysInfo::LittleEndian) {
+        return false;
+    }
+
+    auto screenIterator = xcb_setup_roots_iterator(setup);
+    for (auto i = 0; i < QX11Info::appScreen() && screenIterator.rem; i++) {
+        xcb_screen_next(&screenIterator);
+    }
+    if (!screenIterator.rem) {
+        return false;
+    }
+    auto rootDepth = screenIterator.data->root_depth;
+
+    auto formatIterator = xcb_setup_pixmap_formats_iterator(setup);
+    for (; formatIterator.rem; xcb_format_next(&formatIterator)) {
+        if (formatIterator.data->depth == rootDepth) {
+            return formatIterator.data->bits_per_pixel == 32 && (rootDepth == 24 || rootDepth == 32);
+        }
+    }
+    return false;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef X11SHMGRABBER_H
+#define X11SHMGRABBER_H
+
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <xcb/shm.h>
+
+#include <QGuiApplication>
+#include <QImage>
+#include <QSysInfo>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <atomic>
+
+#include "src/helper/X11GraphicsHelper.h"
+
+class X11ShmGrabber
+{
+public:
+    X11ShmGrabber();
+    ~X11ShmGrabber();
+    bool isAvailable() const;
+    QImage grabRect(const QRect &rect);
+    void setPoolLimit(qint64 bytes);
+    qint64 poolSize() const;
+
+private:
+    struct Segment {
+        X11ShmGrabber *owner;
+        xcb_shm_seg_t  id;
+        uchar         *data;
+        QSize          size;
+        qint64         byteCount;
+        bool           inUse;
+    };
+
+    std::atomic<bool> mIsAvailable;
+    QList<Segment *>  mSegments;
+    qint64            mPoolSize;
+    qint64            mPoolLimit;
+    mutable QMutex    mMutex;
+    static QMutex     mOwnerMutex;
+
+    bool isServerSupported() const;
+    bool isPixmapFormatSupported() const;
+    Segment *acquireSegment(const QSize &size);
+    Segment *createSegment(const QSize &size);
+    void returnSegment(Segment *segment);
+    void trimPool(qint64 requiredBytes);
+    static void destroySegment(Segment *segment);
+    static void releaseSegment(void *info);
+};
+
+#endif // X11SHMGRABBER_H
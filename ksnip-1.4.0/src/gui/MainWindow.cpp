@@ -20,60 +20,76 @@
 
 #include "MainWindow.h"
 
+Q_LOGGING_CATEGORY(ksnipStartup, "ksnip.startup", QtWarningMsg)
+
 MainWindow::MainWindow(RunMode mode) : QMainWindow(),
     mMode(mode),
-    mNewCaptureButton(new CustomToolButton(this)),
-    mSaveButton(new QToolButton(this)),
-    mCopyToClipboardButton(new QToolButton(this)),
-    mPaintToolButton(new CustomToolButton(this)),
-    mSettingsButton(new SettingsPicker(this, 5)),
-    mPaintToolMenu(new CustomMenu(mPaintToolButton)),
-    mNewCaptureMenu(new CustomMenu(mNewCaptureButton)),
-    mNewRectAreaCaptureAction(new QAction(this)),
-    mNewCurrentScreenCaptureAction(new QAction(this)),
-    mNewFullScreenCaptureAction(new QAction(this)),
-    mNewActiveWindowCaptureAction(new QAction(this)),
-    mSaveAction(new QAction(this)),
-    mCopyToClipboardAction(new QAction(this)),
-    mPenAction(new QAction(this)),
-    mMarkerAction(new QAction(this)),
-    mRectAction(new QAction(this)),
-    mEllipseAction(new QAction(this)),
-    mLineAction(new QAction(this)),
-    mArrowAction(new QAction(this)),
-    mTextAction(new QAction(this)),
-    mNumberAction(new QAction(this)),
-    mEraseAction(new QAction(this)),
-    mMoveAction(new QAction(this)),
-    mSelectAction(new QAction(this)),
-    mUploadToImgurAction(new QAction(this)),
-    mPrintAction(new QAction(this)),
-    mPrintPreviewAction(new QAction(this)),
-    mCropAction(new QAction(this)),
-    mNewCaptureAction(new QAction(this)),
-    mQuitAction(new QAction(this)),
-    mSettingsDialogAction(new QAction(this)),
-    mAboutKsnipAction(new QAction(this)),
-    mPaintArea(new PaintArea()),
-    mCaptureView(new CaptureView(mPaintArea)),
-    mUndoAction(mPaintArea->getUndoAction()),
-    mRedoAction(mPaintArea->getRedoAction()),
+    mIsUnsaved(false),
+    mHidden(false),
+    mImageRevision(0),
+    mNewCaptureButton(nullptr),
+    mSaveButton(nullptr),
+    mCopyToClipboardButton(nullptr),
+    mPaintToolButton(nullptr),
+    mSettingsButton(nullptr),
+    mPaintToolMenu(nullptr),
+    mNewCaptureMenu(nullptr),
+    mNewRectAreaCaptureAction(nullptr),
+    mNewCurrentScreenCaptureAction(nullptr),
+    mNewFullScreenCaptureAction(nullptr),
+    mNewActiveWindowCaptureAction(nullptr),
+    mSaveAction(nullptr),
+    mCopyToClipboardAction(nullptr),
+    mPenAction(nullptr),
+    mMarkerAction(nullptr),
+    mRectAction(nullptr),
+    mEllipseAction(nullptr),
+    mLineAction(nullptr),
+    mArrowAction(nullptr),
+    mTextAction(nullptr),
+    mNumberAction(nullptr),
+    mRedactAction(nullptr),
+    mEraseAction(nullptr),
+    mMoveAction(nullptr),
+    mSelectAction(nullptr),
+    mUploadToImgurAction(nullptr),
+    mPrintAction(nullptr),
+    mPrintPreviewAction(nullptr),
+    mCropAction(nullptr),
+    mNewCaptureAction(nullptr),
+    mQuitAction(nullptr),
+    mSettingsDialogAction(nullptr),
+    mAboutKsnipAction(nullptr),
+    mToolBar(nullptr),
+    mPaintArea(nullptr),
+    mCaptureView(nullptr),
+    mUndoAction(nullptr),
+    mRedoAction(nullptr),
     mClipboard(QApplication::clipboard()),
-    mImageGrabber(new ImageGrabber(this)),
-    mImgurUploader(new ImgurUploader(this)),
-    mCropPanel(new CropPanel(mCaptureView)),
+    mImageGrabber(nullptr),
+    mImgurUploader(nullptr),
+    mImageSaver(new ImageSaver(this)),
+    mBurstWriter(nullptr),
+    mSaveProgressBar(nullptr),
+    mCropPanel(nullptr),
     mConfig(KsnipConfig::instance()),
-    mSettingsPickerConfigurator(new SettingsPickerConfigurator())
+    mSettingsPickerConfigurator(nullptr)
 {
     // When we run in CLI only mode we don't need to setup gui, but only need
-    // to connect imagegrabber signals to mainwindow slots to handle the
-    // feedback.
-    if (mMode == RunMode::CLI) {
-        connect(mImageGrabber, &ImageGrabber::finished, this, &MainWindow::instantSave);
-        connect(mImageGrabber, &ImageGrabber::canceled, this, &MainWindow::close);
+    // to connect imagesaver signals to mainwindow slots to handle the
+    // feedback. The daemon works the same way but keeps running after a
+    // capture was written or canceled. The image grabber connects itself on
+    // first use.
+    if (mMode == RunMode::CLI || mMode == RunMode::Daemon) {
+        connect(mImageSaver, &ImageSaver::finished, this, &MainWindow::saveFinished);
         return;
     }
 
+    QElapsedTimer startupTimer;
+    QElapsedTimer stepTimer;
+    startupTimer.start();
+    stepTimer.start();
+
     initGui();
 
     mCaptureView->hide();
@@ -82,32 +98,26 @@ MainWindow::MainWindow(RunMode mode) : QMainWindow(),
     move(mConfig->windowPosition());
 
     connect(mPaintArea, &PaintArea::imageChanged, [this]() {
+        mImageRevision++;
         setSaveAble(true);
         if (mConfig->alwaysCopyToClipboard()) {
             copyToClipboard();
         }
     });
 
-
-    connect(mImageGrabber, &ImageGrabber::finished, this, &MainWindow::showCapture);
-    connect(mImageGrabber, &ImageGrabber::canceled, [this]() {
-        setHidden(false);
-    });
-
-    connect(mImgurUploader, &ImgurUploader::uploadFinished,
-            this, &MainWindow::imgurUploadFinished);
-    connect(mImgurUploader, &ImgurUploader::error,
-            this, &MainWindow::imgurError);
-    connect(mImgurUploader, &ImgurUploader::tokenUpdated,
-            this, &MainWindow::imgurTokenUpdated);
-    connect(mImgurUploader, &ImgurUploader::tokenRefreshRequired,
-            this, &MainWindow::imgurTokenRefresh);
-    connect(mCropPanel, &CropPanel::closing,
-            this, &MainWindow::closeCrop);
+    connect(mImageSaver, &ImageSaver::started,
+            this, &MainWindow::saveStarted);
+    connect(mImageSaver, &ImageSaver::progressChanged,
+            mSaveProgressBar, &QProgressBar::setValue);
+    connect(mImageSaver, &ImageSaver::finished,
+            this, &MainWindow::saveFinished);
     connect(mCaptureView, &CaptureView::closeCrop,
             this, &MainWindow::closeCrop);
 
+    qCDebug(ksnipStartup, "Created widgets and actions in %lld ms", stepTimer.restart());
+
     loadSettings();
+    qCDebug(ksnipStartup, "Loaded settings in %lld ms", stepTimer.restart());
 
     // If requested by user, run capture on startup which will afterward show
     // the mainwindow, otherwise show the mainwindow right away.
@@ -116,6 +126,13 @@ MainWindow::MainWindow(RunMode mode) : QMainWindow(),
     } else {
         show();
     }
+    qCDebug(ksnipStartup, "Started capture or showed window in %lld ms", stepTimer.restart());
+
+    // The zero timer fires once the event loop has processed the pending
+    // show and paint events, which is when the first frame is on screen.
+    QTimer::singleShot(0, this, [startupTimer]() {
+        qCDebug(ksnipStartup, "First frame after %lld ms", startupTimer.elapsed());
+    });
 }
 
 //
@@ -129,7 +146,56 @@ void MainWindow::instantCapture(ImageGrabber::CaptureMode captureMode,
                                 bool captureCursor,
                                 int delay)
 {
-    mImageGrabber->grabImage(captureMode, captureCursor, delay);
+    imageGrabber()->grabImage(captureMode, captureCursor, delay);
+}
+
+/*
+ * Interval capture used from command line. Frames are handed to the burst
+ * writer which writes them in the background, so a slow disk doesn't delay
+ * the capture cadence.
+ */
+void MainWindow::instantBurst(ImageGrabber::CaptureMode captureMode,
+                              bool captureCursor,
+                              int delay,
+                              int interval,
+                              int frameCount)
+{
+    startBurstWriter();
+    imageGrabber()->grabBurst(captureMode, captureCursor, delay, interval, frameCount);
+}
+
+/*
+ * Same as instantBurst, but frames are only taken when the screen changed.
+ */
+void MainWindow::instantWatch(ImageGrabber::CaptureMode captureMode,
+                              bool captureCursor,
+                              int delay,
+                              int frameCount)
+{
+    startBurstWriter();
+    imageGrabber()->grabWatch(captureMode, captureCursor, delay, frameCount);
+}
+
+/*
+ * Scrolling capture of the active window, the stitched image is saved like a
+ * regular instant capture.
+ */
+void MainWindow::instantScroll(int delay)
+{
+    connect(imageGrabber(), &ImageGrabber::scrollFinished, [this](const QImage& image) {
+        if (image.isNull()) {
+            qCritical("MainWindow::instantScroll: Nothing was captured.");
+            close();
+            return;
+        }
+        mImageSaver->save(image, mConfig->savePath());
+    });
+    imageGrabber()->grabScroll(delay);
+}
+
+void MainWindow::stopBurst()
+{
+    imageGrabber()->stopBurst();
 }
 
 /*
@@ -157,11 +223,13 @@ void MainWindow::showCapture(const QPixmap& screenshot)
     }
 
     setHidden(false);
+    initPaintTools();
     mPaintArea->loadCapture(screenshot);
     mPaintArea->setIsEnabled(true);
+    mImageRevision++;
 
-    if (mPaintArea->areaSize().width() > mImageGrabber->currectScreenRect().width() ||
-            mPaintArea->areaSize().height() > mImageGrabber->currectScreenRect().height()) {
+    if (mPaintArea->areaSize().width() > imageGrabber()->currectScreenRect().width() ||
+            mPaintArea->areaSize().height() > imageGrabber()->currectScreenRect().height()) {
         setWindowState(Qt::WindowMaximized);
     } else {
         resize();
@@ -197,15 +265,17 @@ void MainWindow::openCrop()
     if (!mPaintArea->isValid()) {
         return;
     }
-    statusBar()->addPermanentWidget(mCropPanel, 1);
+    statusBar()->addPermanentWidget(cropPanel(), 1);
     mCropPanel->show();
     statusBar()->setHidden(false);
 }
 
 void MainWindow::closeCrop()
 {
-    statusBar()->removeWidget(mCropPanel);
-    statusBar()->setHidden(true);
+    if (mCropPanel) {
+        statusBar()->removeWidget(mCropPanel);
+    }
+    statusBar()->setHidden(!mImageSaver->isSaving());
 }
 
 MainWindow::RunMode MainWindow::getMode() const
@@ -305,6 +375,9 @@ void MainWindow::sizeChanged(int size)
     case Painter::Number:
         mConfig->setNumberSize(size);
         break;
+    case Painter::Redact:
+        mConfig->setRedactSize(size);
+        break;
     case Painter::Erase:
         mConfig->setEraseSize(size);
     default:
@@ -324,6 +397,14 @@ void MainWindow::moveEvent(QMoveEvent* event)
 
 void MainWindow::closeEvent(QCloseEvent* event)
 {
+    // Don't quit while a capture is still being written, otherwise we would
+    // leave a truncated file behind.
+    if (mImageSaver->isSaving()) {
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        mImageSaver->waitForFinished();
+        QApplication::restoreOverrideCursor();
+    }
+
     if (mConfig->promptSaveBeforeExit() && mIsUnsaved) {
         auto reply = popupQuestion(tr("Warning - ") + QApplication::applicationName(),
                                    tr("The capture has been modified.\nDo you want to save it?"));
@@ -415,45 +496,6 @@ void MainWindow::setEnablements(bool enabled)
  */
 void MainWindow::loadSettings()
 {
-    // Load paintmode setting
-    switch (mConfig->paintMode()) {
-    case Painter::Pen:
-        setPaintMode(Painter::Pen, false);
-        mPaintToolButton->setDefaultAction(mPenAction);
-        break;
-    case Painter::Marker:
-        setPaintMode(Painter::Marker, false);
-        mPaintToolButton->setDefaultAction(mMarkerAction);
-        break;
-    case Painter::Rect:
-        setPaintMode(Painter::Rect, false);
-        mPaintToolButton->setDefaultAction(mRectAction);
-        break;
-    case Painter::Ellipse:
-        setPaintMode(Painter::Ellipse, false);
-        mPaintToolButton->setDefaultAction(mEllipseAction);
-        break;
-    case Painter::Line:
-        setPaintMode(Painter::Line, false);
-        mPaintToolButton->setDefaultAction(mLineAction);
-        break;
-    case Painter::Arrow:
-        setPaintMode(Painter::Arrow, false);
-        mPaintToolButton->setDefaultAction(mArrowAction);
-        break;
-    case Painter::Text:
-        setPaintMode(Painter::Text, false);
-        mPaintToolButton->setDefaultAction(mTextAction);
-        break;
-    case Painter::Number:
-        setPaintMode(Painter::Number, false);
-        mPaintToolButton->setDefaultAction(mNumberAction);
-        break;
-    default:
-        setPaintMode(Painter::Pen, false);
-        mPaintToolButton->setDefaultAction(mPenAction);
-    }
-
     // Load capture mode setting
     switch (mConfig->captureMode()) {
     case ImageGrabber::ActiveWindow:
@@ -504,11 +546,16 @@ bool MainWindow::popupQuestion(const QString& title, const QString& question)
  */
 QIcon MainWindow::createIcon(const QString& name)
 {
+    // The resource root is listed once instead of probing every size of every
+    // icon separately.
+    static const auto resources = QDir(":/").entryList(QDir::Files).toSet();
+
     QIcon tmpIcon;
 
     for (auto i = 16; i <= 64; i = i * 2) {
-        if (QResource(":" + name + QString::number(i) + ".png").isValid()) {
-            tmpIcon.addFile((":" + name + QString::number(i) + ".png"), QSize(i, i));
+        auto fileName = name + QString::number(i) + ".png";
+        if (resources.contains(fileName)) {
+            tmpIcon.addFile(":" + fileName, QSize(i, i));
         }
     }
 
@@ -549,12 +596,114 @@ bool MainWindow::hidden() const
 void MainWindow::capture(ImageGrabber::CaptureMode captureMode)
 {
     setHidden(true);
-    mImageGrabber->grabImage(captureMode, mConfig->captureCursor(), mConfig->captureDelay());
+    imageGrabber()->grabImage(captureMode, mConfig->captureCursor(), mConfig->captureDelay());
     mConfig->setCaptureMode(captureMode);
 }
 
+/*
+ * The image grabber probes the X server for the shared memory extension, so it
+ * is only created when the first capture is requested.
+ */
+ImageGrabber* MainWindow::imageGrabber()
+{
+    if (mImageGrabber) {
+        return mImageGrabber;
+    }
+
+    mImageGrabber = new ImageGrabber(this);
+    switch (mMode) {
+    case RunMode::CLI:
+        connect(mImageGrabber, &ImageGrabber::finished, this, &MainWindow::instantSave);
+        connect(mImageGrabber, &ImageGrabber::canceled, this, &MainWindow::close);
+        break;
+    case RunMode::Daemon:
+        connect(mImageGrabber, &ImageGrabber::finished, this, &MainWindow::instantSave);
+        connect(mImageGrabber, &ImageGrabber::canceled, [this]() {
+            emit captureFinished(QString(), false);
+        });
+        break;
+    default:
+        connect(mImageGrabber, &ImageGrabber::finished, this, &MainWindow::showCapture);
+        connect(mImageGrabber, &ImageGrabber::canceled, [this]() {
+            setHidden(false);
+        });
+    }
+    return mImageGrabber;
+}
+
+/*
+ * The uploader and its network access manager are only needed once the user
+ * uploads something.
+ */
+ImgurUploader* MainWindow::imgurUploader()
+{
+    if (mImgurUploader) {
+        return mImgurUploader;
+    }
+
+    mImgurUploader = new ImgurUploader(this);
+    connect(mImgurUploader, &ImgurUploader::uploadFinished,
+            this, &MainWindow::imgurUploadFinished);
+    connect(mImgurUploader, &ImgurUploader::error,
+            this, &MainWindow::imgurError);
+    connect(mImgurUploader, &ImgurUploader::tokenUpdated,
+            this, &MainWindow::imgurTokenUpdated);
+    connect(mImgurUploader, &ImgurUploader::tokenRefreshRequired,
+            this, &MainWindow::imgurTokenRefresh);
+    return mImgurUploader;
+}
+
+CropPanel* MainWindow::cropPanel()
+{
+    if (!mCropPanel) {
+        mCropPanel = new CropPanel(mCaptureView);
+        connect(mCropPanel, &CropPanel::closing,
+                this, &MainWindow::closeCrop);
+    }
+    return mCropPanel;
+}
+
+void MainWindow::startBurstWriter()
+{
+    mBurstWriter = new BurstWriter(mConfig->burstRingSize(), this);
+    connect(imageGrabber(), &ImageGrabber::frameGrabbed,
+            mBurstWriter, &BurstWriter::enqueue);
+    connect(imageGrabber(), &ImageGrabber::burstFinished,
+            this, &MainWindow::burstFinished);
+    mBurstWriter->start(mConfig->savePath());
+}
+
 void MainWindow::initGui()
 {
+    // Widgets and actions are only created when running with GUI, CLI and
+    // daemon mode don't need them.
+    mNewCaptureButton = new CustomToolButton(this);
+    mSaveButton = new QToolButton(this);
+    mCopyToClipboardButton = new QToolButton(this);
+    mPaintToolButton = new CustomToolButton(this);
+    mSettingsButton = new SettingsPicker(this, 5);
+    mNewCaptureMenu = new CustomMenu(mNewCaptureButton);
+    mNewRectAreaCaptureAction = new QAction(this);
+    mNewCurrentScreenCaptureAction = new QAction(this);
+    mNewFullScreenCaptureAction = new QAction(this);
+    mNewActiveWindowCaptureAction = new QAction(this);
+    mSaveAction = new QAction(this);
+    mCopyToClipboardAction = new QAction(this);
+    mUploadToImgurAction = new QAction(this);
+    mPrintAction = new QAction(this);
+    mPrintPreviewAction = new QAction(this);
+    mCropAction = new QAction(this);
+    mNewCaptureAction = new QAction(this);
+    mQuitAction = new QAction(this);
+    mSettingsDialogAction = new QAction(this);
+    mAboutKsnipAction = new QAction(this);
+    mPaintArea = new PaintArea();
+    mCaptureView = new CaptureView(mPaintArea);
+    mUndoAction = mPaintArea->getUndoAction();
+    mRedoAction = mPaintArea->getRedoAction();
+    mSaveProgressBar = new QProgressBar(this);
+    mSettingsPickerConfigurator = new SettingsPickerConfigurator();
+
     // Create actions
 
     // Create actions for capture modes
@@ -630,7 +779,154 @@ void MainWindow::initGui()
     mCropAction->setShortcut(Qt::SHIFT + Qt::Key_C);
     connect(mCropAction, &QAction::triggered, this, &MainWindow::openCrop);
 
-    // Create actions for paint mode
+    // Create action for new capture, this will be only used in the menu bar
+    mNewCaptureAction->setText(tr("New"));
+    mNewCaptureAction->setShortcut(QKeySequence::New);
+    connect(mNewCaptureAction, &QAction::triggered,
+            mNewCaptureButton, &CustomToolButton::trigger);
+
+    // Create exit action
+    mQuitAction->setText(tr("Quit"));
+    mQuitAction->setShortcut(QKeySequence::Quit);
+    mQuitAction->setIcon(QIcon::fromTheme("application-exit"));
+    connect(mQuitAction, &QAction::triggered, this, &MainWindow::close);
+
+    // Create action for opening settings dialog
+    mSettingsDialogAction->setText(tr("Settings"));
+    mSettingsDialogAction->setIcon(QIcon::fromTheme("emblem-system"));
+    connect(mSettingsDialogAction, &QAction::triggered, [this]() {
+        SettingsDialog settingsDialog(this);
+        settingsDialog.exec();
+    });
+
+    mAboutKsnipAction->setText(tr("&About"));
+    mAboutKsnipAction->setIcon(createIcon("ksnip"));
+    connect(mAboutKsnipAction, &QAction::triggered, [this]() {
+        AboutDialog aboutDialog(this);
+        aboutDialog.exec();
+    });
+
+    // Undo and redo actions, the action itself is created in the paintarea
+    // class and only a pointer returned here.
+    mUndoAction->setIcon(QIcon::fromTheme("edit-undo"));
+    mUndoAction->setShortcut(QKeySequence::Undo);
+
+    mRedoAction->setIcon(QIcon::fromTheme("edit-redo"));
+    mRedoAction->setShortcut(QKeySequence::Redo);
+
+    // Create tool buttons
+
+    // Create tool button for selecting new capture mode
+    mNewCaptureMenu->addAction(mNewRectAreaCaptureAction);
+    mNewCaptureMenu->addAction(mNewFullScreenCaptureAction);
+    mNewCaptureMenu->addAction(mNewCurrentScreenCaptureAction);
+    mNewCaptureMenu->addAction(mNewActiveWindowCaptureAction);
+
+    mNewCaptureButton->setMenu(mNewCaptureMenu);
+    mNewCaptureButton->setToolButtonStyle(Qt::ToolButtonTextBesideIcon);
+    mNewCaptureButton->setDefaultAction(mNewRectAreaCaptureAction);
+    mNewCaptureButton->setButtonText(tr("New"));
+
+    // Create save tool button
+    mSaveButton->setToolButtonStyle(Qt::ToolButtonTextBesideIcon);
+    mSaveButton->addAction(mSaveAction);
+    mSaveButton->setDefaultAction(mSaveAction);
+
+    // Create copy to clipboard tool button
+    mCopyToClipboardButton->setToolButtonStyle(Qt::ToolButtonTextBesideIcon);
+    mCopyToClipboardButton->addAction(mCopyToClipboardAction);
+    mCopyToClipboardButton->setDefaultAction(mCopyToClipboardAction);
+
+    // Create painter settings tool button;
+    mSettingsButton->setIcon(createIcon("painterSettings"));
+    mSettingsButton->setToolTip(tr("Setting Painter tool configuration"));
+    mSettingsButton->setEnabled(false);
+    connect(mSettingsButton, &SettingsPicker::colorChanged,
+            this, &MainWindow::colorChanged);
+    connect(mSettingsButton, &SettingsPicker::fillChanged,
+            this, &MainWindow::fillChanged);
+    connect(mSettingsButton, &SettingsPicker::sizeChanged,
+            this, &MainWindow::sizeChanged);
+
+    // The paint tools are created with the first capture, until then the
+    // button only takes its space in the toolbar.
+    mPaintToolButton->setToolButtonStyle(Qt::ToolButtonIconOnly);
+    mPaintToolButton->setIcon(createIcon("pen"));
+    mPaintToolButton->setEnabled(false);
+
+    // Create progress bar, shown in the status bar while a save is pending
+    mSaveProgressBar->setRange(0, 100);
+    mSaveProgressBar->setMaximumWidth(100);
+    mSaveProgressBar->hide();
+
+    // Create menu bar
+    QMenu* menu;
+    menu = menuBar()->addMenu(tr("File"));
+    menu->addAction(mNewCaptureAction);
+    menu->addAction(mSaveAction);
+    menu->addAction(mUploadToImgurAction);
+    menu->addSeparator();
+    menu->addAction(mPrintAction);
+    menu->addAction(mPrintPreviewAction);
+    menu->addSeparator();
+    menu->addAction(mQuitAction);
+    menu = menuBar()->addMenu(tr("&Edit"));
+    menu->addAction(mUndoAction);
+    menu->addAction(mRedoAction);
+    menu->addSeparator();
+    menu->addAction(mCopyToClipboardAction);
+    menu->addAction(mCropAction);
+    menu = menuBar()->addMenu(tr("&Options"));
+    menu->addAction(mSettingsDialogAction);
+    menu = menuBar()->addMenu(tr("&Help"));
+    menu->addAction(mAboutKsnipAction);
+
+    // Create toolbar
+    mToolBar = addToolBar("Tools");
+    mToolBar->setFloatable(false);
+    mToolBar->setMovable(false);
+    mToolBar->setAllowedAreas(Qt::BottomToolBarArea);
+    mToolBar->addWidget(mNewCaptureButton);
+    mToolBar->addSeparator();
+    mToolBar->addWidget(mSaveButton);
+    mToolBar->addWidget(mCopyToClipboardButton);
+    mToolBar->addSeparator();
+    mToolBar->addWidget(mPaintToolButton);
+    mToolBar->addWidget(mSettingsButton);
+    mToolBar->setFixedSize(mToolBar->sizeHint());
+
+    setCentralWidget(mCaptureView);
+    resize();
+}
+
+/*
+ * Paint tools are only of use once a capture is shown, so their actions and
+ * menu are created with the first capture instead of on startup. Until then
+ * the paint area stays in its default mode, shortcuts of the tools work from
+ * then on.
+ */
+void MainWindow::initPaintTools()
+{
+    if (mPaintToolMenu) {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    mPenAction = new QAction(this);
+    mMarkerAction = new QAction(this);
+    mRectAction = new QAction(this);
+    mEllipseAction = new QAction(this);
+    mLineAction = new QAction(this);
+    mArrowAction = new QAction(this);
+    mTextAction = new QAction(this);
+    mNumberAction = new QAction(this);
+    mRedactAction = new QAction(this);
+    mEraseAction = new QAction(this);
+    mMoveAction = new QAction(this);
+    mSelectAction = new QAction(this);
+
     mPenAction->setText(tr("Pen"));
     mPenAction->setIcon(createIcon("pen"));
     mPenAction->setShortcut(Qt::Key_P);
@@ -703,6 +999,15 @@ void MainWindow::initGui()
         }
     });
 
+    mRedactAction->setText(tr("Redact"));
+    mRedactAction->setIcon(createIcon("redact"));
+    mRedactAction->setShortcut(Qt::Key_X);
+    connect(mRedactAction, &QAction::triggered, [this]() {
+        if (mPaintArea->paintMode() != Painter::Redact) {
+            setPaintMode(Painter::Redact);
+        }
+    });
+
     mEraseAction->setText(tr("Erase"));
     mEraseAction->setIcon(createIcon("eraser"));
     mEraseAction->setShortcut(Qt::Key_D);
@@ -730,65 +1035,7 @@ void MainWindow::initGui()
         }
     });
 
-    // Create action for new capture, this will be only used in the menu bar
-    mNewCaptureAction->setText(tr("New"));
-    mNewCaptureAction->setShortcut(QKeySequence::New);
-    connect(mNewCaptureAction, &QAction::triggered,
-            mNewCaptureButton, &CustomToolButton::trigger);
-
-    // Create exit action
-    mQuitAction->setText(tr("Quit"));
-    mQuitAction->setShortcut(QKeySequence::Quit);
-    mQuitAction->setIcon(QIcon::fromTheme("application-exit"));
-    connect(mQuitAction, &QAction::triggered, this, &MainWindow::close);
-
-    // Create action for opening settings dialog
-    mSettingsDialogAction->setText(tr("Settings"));
-    mSettingsDialogAction->setIcon(QIcon::fromTheme("emblem-system"));
-    connect(mSettingsDialogAction, &QAction::triggered, [this]() {
-        SettingsDialog settingsDialog(this);
-        settingsDialog.exec();
-    });
-
-    mAboutKsnipAction->setText(tr("&About"));
-    mAboutKsnipAction->setIcon(createIcon("ksnip"));
-    connect(mAboutKsnipAction, &QAction::triggered, [this]() {
-        AboutDialog aboutDialog(this);
-        aboutDialog.exec();
-    });
-
-    // Undo and redo actions, the action itself is created in the paintarea
-    // class and only a pointer returned here.
-    mUndoAction->setIcon(QIcon::fromTheme("edit-undo"));
-    mUndoAction->setShortcut(QKeySequence::Undo);
-
-    mRedoAction->setIcon(QIcon::fromTheme("edit-redo"));
-    mRedoAction->setShortcut(QKeySequence::Redo);
-
-    // Create tool buttons
-
-    // Create tool button for selecting new capture mode
-    mNewCaptureMenu->addAction(mNewRectAreaCaptureAction);
-    mNewCaptureMenu->addAction(mNewFullScreenCaptureAction);
-    mNewCaptureMenu->addAction(mNewCurrentScreenCaptureAction);
-    mNewCaptureMenu->addAction(mNewActiveWindowCaptureAction);
-
-    mNewCaptureButton->setMenu(mNewCaptureMenu);
-    mNewCaptureButton->setToolButtonStyle(Qt::ToolButtonTextBesideIcon);
-    mNewCaptureButton->setDefaultAction(mNewRectAreaCaptureAction);
-    mNewCaptureButton->setButtonText(tr("New"));
-
-    // Create save tool button
-    mSaveButton->setToolButtonStyle(Qt::ToolButtonTextBesideIcon);
-    mSaveButton->addAction(mSaveAction);
-    mSaveButton->setDefaultAction(mSaveAction);
-
-    // Create copy to clipboard tool button
-    mCopyToClipboardButton->setToolButtonStyle(Qt::ToolButtonTextBesideIcon);
-    mCopyToClipboardButton->addAction(mCopyToClipboardAction);
-    mCopyToClipboardButton->setDefaultAction(mCopyToClipboardAction);
-
-    // Create tool button for selecting paint tool
+    mPaintToolMenu = new CustomMenu(mPaintToolButton);
     mPaintToolMenu->addAction(mPenAction);
     mPaintToolMenu->addAction(mMarkerAction);
     mPaintToolMenu->addAction(mRectAction);
@@ -797,62 +1044,59 @@ void MainWindow::initGui()
     mPaintToolMenu->addAction(mArrowAction);
     mPaintToolMenu->addAction(mTextAction);
     mPaintToolMenu->addAction(mNumberAction);
+    mPaintToolMenu->addAction(mRedactAction);
     mPaintToolMenu->addAction(mEraseAction);
     mPaintToolMenu->addAction(mMoveAction);
     mPaintToolMenu->addAction(mSelectAction);
 
-    // Create painter settings tool button;
-    mSettingsButton->setIcon(createIcon("painterSettings"));
-    mSettingsButton->setToolTip(tr("Setting Painter tool configuration"));
-    connect(mSettingsButton, &SettingsPicker::colorChanged,
-            this, &MainWindow::colorChanged);
-    connect(mSettingsButton, &SettingsPicker::fillChanged,
-            this, &MainWindow::fillChanged);
-    connect(mSettingsButton, &SettingsPicker::sizeChanged,
-            this, &MainWindow::sizeChanged);
-
     mPaintToolButton->setMenu(mPaintToolMenu);
-    mPaintToolButton->setToolButtonStyle(Qt::ToolButtonIconOnly);
-    mPaintToolButton->setDefaultAction(mPenAction);
-
-    // Create menu bar
-    QMenu* menu;
-    menu = menuBar()->addMenu(tr("File"));
-    menu->addAction(mNewCaptureAction);
-    menu->addAction(mSaveAction);
-    menu->addAction(mUploadToImgurAction);
-    menu->addSeparator();
-    menu->addAction(mPrintAction);
-    menu->addAction(mPrintPreviewAction);
-    menu->addSeparator();
-    menu->addAction(mQuitAction);
-    menu = menuBar()->addMenu(tr("&Edit"));
-    menu->addAction(mUndoAction);
-    menu->addAction(mRedoAction);
-    menu->addSeparator();
-    menu->addAction(mCopyToClipboardAction);
-    menu->addAction(mCropAction);
-    menu = menuBar()->addMenu(tr("&Options"));
-    menu->addAction(mSettingsDialogAction);
-    menu = menuBar()->addMenu(tr("&Help"));
-    menu->addAction(mAboutKsnipAction);
+    mPaintToolButton->setEnabled(true);
+    mSettingsButton->setEnabled(true);
 
-    // Create toolbar
-    mToolBar = addToolBar("Tools");
-    mToolBar->setFloatable(false);
-    mToolBar->setMovable(false);
-    mToolBar->setAllowedAreas(Qt::BottomToolBarArea);
-    mToolBar->addWidget(mNewCaptureButton);
-    mToolBar->addSeparator();
-    mToolBar->addWidget(mSaveButton);
-    mToolBar->addWidget(mCopyToClipboardButton);
-    mToolBar->addSeparator();
-    mToolBar->addWidget(mPaintToolButton);
-    mToolBar->addWidget(mSettingsButton);
-    mToolBar->setFixedSize(mToolBar->sizeHint());
+    // Select the paint tool from the settings
+    switch (mConfig->paintMode()) {
+    case Painter::Pen:
+        setPaintMode(Painter::Pen, false);
+        mPaintToolButton->setDefaultAction(mPenAction);
+        break;
+    case Painter::Marker:
+        setPaintMode(Painter::Marker, false);
+        mPaintToolButton->setDefaultAction(mMarkerAction);
+        break;
+    case Painter::Rect:
+        setPaintMode(Painter::Rect, false);
+        mPaintToolButton->setDefaultAction(mRectAction);
+        break;
+    case Painter::Ellipse:
+        setPaintMode(Painter::Ellipse, false);
+        mPaintToolButton->setDefaultAction(mEllipseAction);
+        break;
+    case Painter::Line:
+        setPaintMode(Painter::Line, false);
+        mPaintToolButton->setDefaultAction(mLineAction);
+        break;
+    case Painter::Arrow:
+        setPaintMode(Painter::Arrow, false);
+        mPaintToolButton->setDefaultAction(mArrowAction);
+        break;
+    case Painter::Text:
+        setPaintMode(Painter::Text, false);
+        mPaintToolButton->setDefaultAction(mTextAction);
+        break;
+    case Painter::Number:
+        setPaintMode(Painter::Number, false);
+        mPaintToolButton->setDefaultAction(mNumberAction);
+        break;
+    case Painter::Redact:
+        setPaintMode(Painter::Redact, false);
+        mPaintToolButton->setDefaultAction(mRedactAction);
+        break;
+    default:
+        setPaintMode(Painter::Pen, false);
+        mPaintToolButton->setDefaultAction(mPenAction);
+    }
 
-    setCentralWidget(mCaptureView);
-    resize();
+    qCDebug(ksnipStartup, "Created paint tools in %lld ms", timer.elapsed());
 }
 
 //
@@ -871,13 +1115,11 @@ void MainWindow::saveCaptureClicked()
         return;
     }
 
-    if (!mPaintArea->exportAsImage().save(saveDialog.selectedFiles().first())) {
-        qCritical("PaintWindow::saveCaptureClicked: Unable to save file '%s'",
-                  qPrintable(saveDialog.selectedFiles().first()));
-        return;
-    }
-
-    setSaveAble(false);
+    // Only the export happens here, encoding and writing is done by the saver
+    // in the background. The capture is marked as saved in saveFinished().
+    auto path = saveDialog.selectedFiles().first();
+    auto id = mImageSaver->save(mPaintArea->exportAsImage(), path);
+    mPendingSaves[id] = mImageRevision;
 }
 
 /*
@@ -893,11 +1135,11 @@ void MainWindow::imgurUploadClicked()
 
     // Upload to Imgur Account
     if (!mConfig->imgurForceAnonymous() && !mConfig->imgurAccessToken().isEmpty()) {
-        mImgurUploader->startUpload(mPaintArea->exportAsImage(),
-                                    mConfig->imgurAccessToken());
+        imgurUploader()->startUpload(mPaintArea->exportAsImage(),
+                                     mConfig->imgurAccessToken());
     } else {
         // Upload Anonymous
-        mImgurUploader->startUpload(mPaintArea->exportAsImage());
+        imgurUploader()->startUpload(mPaintArea->exportAsImage());
     }
 
     statusBar()->showMessage(tr("Waiting for imgur.com..."));
@@ -1014,9 +1256,9 @@ void MainWindow::imgurTokenUpdated(const QString& accessToken,
  */
 void MainWindow::imgurTokenRefresh()
 {
-    mImgurUploader->refreshToken(mConfig->imgurRefreshToken(),
-                                 mConfig->imgurClientId(),
-                                 mConfig->imgurClientSecret());
+    imgurUploader()->refreshToken(mConfig->imgurRefreshToken(),
+                                  mConfig->imgurClientId(),
+                                  mConfig->imgurClientSecret());
 
     statusBar()->showMessage("Imgur token has expired, requesting new token...");
 }
@@ -1048,17 +1290,75 @@ void MainWindow::setPaintMode(Painter::Modes mode, bool save)
  */
 void MainWindow::instantSave(const QPixmap& pixmap)
 {
-    QString savePath = mConfig->savePath();
+    mImageSaver->save(pixmap.toImage(), mConfig->savePath());
+}
+
+/*
+ * Called once the last frame of an interval capture was grabbed, we exit as
+ * soon as the writer has written the remaining frames.
+ */
+void MainWindow::burstFinished(int missedFrames)
+{
+    connect(mBurstWriter, &BurstWriter::finished, [this, missedFrames]() {
+        qInfo("Interval capture finished: %d frames grabbed, %d written, %d failed to write, "
+              "%d dropped because writing fell behind, %d missed because capturing fell behind.",
+              mBurstWriter->frameCount(),
+              mBurstWriter->writtenCount(),
+              mBurstWriter->failedCount(),
+              mBurstWriter->droppedCount(),
+              missedFrames);
+        close();
+    });
+    mBurstWriter->finish();
+}
 
-    if (pixmap.save(savePath)) {
-        qInfo("Screenshot saved to: %s", qPrintable(savePath));
+void MainWindow::saveStarted(int, const QString& path)
+{
+    if (mSaveProgressBar->isHidden()) {
+        statusBar()->addPermanentWidget(mSaveProgressBar);
+        mSaveProgressBar->show();
+        statusBar()->setHidden(false);
+    }
+    statusBar()->showMessage(tr("Saving to %1...").arg(path));
+}
+
+/*
+ * Called once the file was written. The unsaved state is only cleared when the
+ * capture was not modified while it was written in the background.
+ */
+void MainWindow::saveFinished(int id, const QString& path, bool success)
+{
+    if (success) {
+        qInfo("Screenshot saved to: %s", qPrintable(path));
     } else {
-        qCritical("MainWindow::instantSave: Failed to save file at '%s'",
-                  qPrintable(savePath));
+        qCritical("MainWindow::saveFinished: Failed to save file at '%s'",
+                  qPrintable(path));
     }
 
+    emit captureFinished(path, success);
+
     // If we are running CLI mode, this is the exit point.
     if (mMode == CLI) {
         close();
+        return;
+    }
+
+    if (mMode == Daemon) {
+        return;
+    }
+
+    auto revision = mPendingSaves.take(id);
+    if (success && revision == mImageRevision) {
+        setSaveAble(false);
+    }
+
+    if (!mImageSaver->isSaving()) {
+        statusBar()->removeWidget(mSaveProgressBar);
+    }
+
+    if (success) {
+        statusBar()->showMessage(tr("Saved to %1").arg(path), 3000);
+    } else {
+        statusBar()->showMessage(tr("Unable to save capture to %1").arg(path), 3000);
     }
 }
@@ -37,6 +37,10 @@
 #include "src/backend/ImageGrabber.h"
 #include "src/backend/KsnipConfig.h"
 #include "src/backend/ImgurUploader.h"
+#include "src/backend/ImageSaver.h"
+#include "src/backend/BurstWriter.h"
+
+Q_DECLARE_LOGGING_CATEGORY(ksnipStartup)
 
 class MainWindow : public QMainWindow
 {
@@ -44,7 +48,8 @@ class MainWindow : public QMainWindow
 public:
     enum RunMode {
         GUI,
-        CLI
+        CLI,
+        Daemon
     };
 
 public:
@@ -53,6 +58,17 @@ public:
     void instantCapture(ImageGrabber::CaptureMode captureMode,
                         bool capureCursor = true,
                         int delay = 0);
+    void instantBurst(ImageGrabber::CaptureMode captureMode,
+                      bool captureCursor,
+                      int delay,
+                      int interval,
+                      int frameCount);
+    void instantWatch(ImageGrabber::CaptureMode captureMode,
+                      bool captureCursor,
+                      int delay,
+                      int frameCount);
+    void instantScroll(int delay);
+    void stopBurst();
     void resize();
     RunMode getMode() const;
     virtual QMenu *createPopupMenu() override;
@@ -65,6 +81,9 @@ public slots:
     void fillChanged(bool fill);
     void sizeChanged(int size);
 
+signals:
+    void captureFinished(const QString &path, bool success) const;
+
 protected:
     virtual void moveEvent(QMoveEvent *event) override;
     virtual void closeEvent(QCloseEvent *event) override;
@@ -74,6 +93,7 @@ private:
     RunMode           mMode;
     bool              mIsUnsaved;
     bool              mHidden;
+    int               mImageRevision;
     CustomToolButton *mNewCaptureButton;
     QToolButton      *mSaveButton;
     QToolButton      *mCopyToClipboardButton;
@@ -95,6 +115,7 @@ private:
     QAction          *mArrowAction;
     QAction          *mTextAction;
     QAction          *mNumberAction;
+    QAction          *mRedactAction;
     QAction          *mEraseAction;
     QAction          *mMoveAction;
     QAction          *mSelectAction;
@@ -114,6 +135,10 @@ private:
     QClipboard       *mClipboard;
     ImageGrabber     *mImageGrabber;
     ImgurUploader    *mImgurUploader;
+    ImageSaver       *mImageSaver;
+    BurstWriter      *mBurstWriter;
+    QProgressBar     *mSaveProgressBar;
+    QHash<int, int>   mPendingSaves;
     CropPanel        *mCropPanel;
     KsnipConfig      *mConfig;
     SettingsPickerConfigurator *mSettingsPickerConfigurator;
@@ -127,7 +152,12 @@ private:
     void setHidden(bool isHidden);
     bool hidden() const;
     void capture(ImageGrabber::CaptureMode captureMode);
+    void startBurstWriter();
+    ImageGrabber *imageGrabber();
+    ImgurUploader *imgurUploader();
+    CropPanel *cropPanel();
     void initGui();
+    void initPaintTools();
 
 private slots:
     void saveCaptureClicked();
@@ -143,6 +173,9 @@ private slots:
     void imgurTokenRefresh();
     void setPaintMode(Painter::Modes mode, bool save = true);
     void instantSave(const QPixmap &pixmap);
+    void saveStarted(int id, const QString &path);
+    void saveFinished(int id, const QString &path, bool success);
+    void burstFinished(int missedFrames);
 };
 
 #endif // MAINWINDOW_H
@@ -34,6 +34,7 @@ SettingsDialog::SettingsDialog(MainWindow* parent) :
     mImgurAlwaysCopyToClipboardCheckBox(new QCheckBox),
     mSmoothPathCheckbox(new QCheckBox),
     mItemShadowCheckbox(new QCheckBox),
+    mRedactBlurCheckbox(new QCheckBox),
     mCursorRulerCheckbox(new QCheckBox),
     mCursorInfoCheckbox(new QCheckBox),
     mSaveLocationLineEdit(new QLineEdit),
@@ -46,11 +47,13 @@ SettingsDialog::SettingsDialog(MainWindow* parent) :
     mTextFontLabel(new QLabel),
     mNumberFontLabel(new QLabel),
     mSmoothFactorLabel(new QLabel),
+    mPathToleranceLabel(new QLabel),
     mSnippingCursorSizeLabel(new QLabel),
     mSnippingCursorColorLabel(new QLabel),
     mCaptureDelayCombobox(new NumericComboBox(0, 1, 11)),
     mSmoothFactorCombobox(new NumericComboBox(1, 1, 15)),
     mSnippingCursorSizeCombobox(new NumericComboBox(1, 2, 3)),
+    mPathToleranceSpinBox(new QDoubleSpinBox),
     mTextFontCombobox(new QFontComboBox(this)),
     mNumberFontCombobox(new QFontComboBox(this)),
     mBrowseButton(new QPushButton),
@@ -95,6 +98,7 @@ SettingsDialog::~SettingsDialog()
     delete mImgurAlwaysCopyToClipboardCheckBox;
     delete mSmoothPathCheckbox;
     delete mItemShadowCheckbox;
+    delete mRedactBlurCheckbox;
     delete mCursorRulerCheckbox;
     delete mCursorInfoCheckbox;
     delete mSaveLocationLineEdit;
@@ -107,11 +111,13 @@ SettingsDialog::~SettingsDialog()
     delete mTextFontLabel;
     delete mNumberFontLabel;
     delete mSmoothFactorLabel;
+    delete mPathToleranceLabel;
     delete mSnippingCursorSizeLabel;
     delete mSnippingCursorColorLabel;
     delete mCaptureDelayCombobox;
     delete mSmoothFactorCombobox;
     delete mSnippingCursorSizeCombobox;
+    delete mPathToleranceSpinBox;
     delete mTextFontCombobox;
     delete mNumberFontCombobox;
     delete mBrowseButton;
@@ -160,10 +166,12 @@ void SettingsDialog::loadSettings()
     mNumberFontCombobox->setCurrentFont(mConfig->numberFont());
 
     mItemShadowCheckbox->setChecked(mConfig->itemShadowEnabled());
+    mRedactBlurCheckbox->setChecked(mConfig->redactBlur());
 
     mSmoothPathCheckbox->setChecked(mConfig->smoothPathEnabled());
     mSmoothFactorCombobox->setValue(mConfig->smoothFactor());
     smootPathCheckboxClicked(mConfig->smoothPathEnabled());
+    mPathToleranceSpinBox->setValue(mConfig->pathTolerance());
 }
 
 void SettingsDialog::saveSettings()
@@ -197,9 +205,11 @@ void SettingsDialog::saveSettings()
     mConfig->setNumberFont(mNumberFontCombobox->currentFont());
 
     mConfig->setItemShadowEnabled(mItemShadowCheckbox->isChecked());
+    mConfig->setRedactBlur(mRedactBlurCheckbox->isChecked());
 
     mConfig->setSmoothPathEnabled(mSmoothPathCheckbox->isChecked());
     mConfig->setSmoothFactor(mSmoothFactorCombobox->value());
+    mConfig->setPathTolerance(mPathToleranceSpinBox->value());
 }
 
 void SettingsDialog::initGui()
@@ -298,6 +308,10 @@ void SettingsDialog::initGui()
     mItemShadowCheckbox->setText(tr("Paint Item Shadows"));
     mItemShadowCheckbox->setToolTip(tr("When enabled, paint items cast shadows."));
 
+    mRedactBlurCheckbox->setText(tr("Blur Redacted Areas"));
+    mRedactBlurCheckbox->setToolTip(tr("When enabled, redacted areas are blurred,\n"
+                                       "otherwise they are pixelated."));
+
     mSmoothPathCheckbox->setText(tr("Smooth Painter Paths"));
     mSmoothPathCheckbox->setToolTip(tr("When enabled smooths out pen and\n"
                                        "marker paths after finished drawing."));
@@ -311,6 +325,16 @@ void SettingsDialog::initGui()
     mSmoothFactorCombobox->setMinimumWidth(fixedButtonSize);
     mSmoothFactorCombobox->setToolTip(mSmoothFactorLabel->toolTip());
 
+    mPathToleranceLabel->setText(tr("Path Tolerance") + ":");
+    mPathToleranceLabel->setToolTip(tr("Pen and marker points that deviate less than\n"
+                                       "this from the path are merged while drawing,\n"
+                                       "zero keeps every point."));
+    mPathToleranceSpinBox->setRange(0, 3);
+    mPathToleranceSpinBox->setSingleStep(0.25);
+    mPathToleranceSpinBox->setSuffix(tr(" px"));
+    mPathToleranceSpinBox->setMinimumWidth(fixedButtonSize);
+    mPathToleranceSpinBox->setToolTip(mPathToleranceLabel->toolTip());
+
     mTextFontLabel->setText(tr("Text Font") + ":");
     mTextFontLabel->setToolTip(tr("Sets the font for the Text Paint Item."));
     mTextFontCombobox->setToolTip(mTextFontLabel->toolTip());
@@ -413,18 +437,21 @@ void SettingsDialog::initGui()
     painterGrid->setAlignment(Qt::AlignTop);
     painterGrid->setColumnStretch(1, 1);
     painterGrid->addWidget(mItemShadowCheckbox, 0, 0, 1, 2);
-    painterGrid->setRowMinimumHeight(1, 15);
-    painterGrid->addWidget(mSmoothPathCheckbox, 2, 0, 1, 2);
-    painterGrid->addWidget(mSmoothFactorLabel, 3, 0);
-    painterGrid->addWidget(mSmoothFactorCombobox, 3, 1, Qt::AlignLeft);
-    painterGrid->setRowMinimumHeight(4, 15);
-    painterGrid->addWidget(mTextFontLabel, 5, 0);
-    painterGrid->addWidget(mTextFontCombobox, 5, 1);
-    painterGrid->addWidget(mTextBoldButton, 5, 2);
-    painterGrid->addWidget(mTextItalicButton, 5, 3);
-    painterGrid->addWidget(mTextUnderlineButton, 5, 4);
-    painterGrid->addWidget(mNumberFontLabel, 6, 0);
-    painterGrid->addWidget(mNumberFontCombobox, 6, 1);
+    painterGrid->addWidget(mRedactBlurCheckbox, 1, 0, 1, 2);
+    painterGrid->setRowMinimumHeight(2, 15);
+    painterGrid->addWidget(mSmoothPathCheckbox, 3, 0, 1, 2);
+    painterGrid->addWidget(mSmoothFactorLabel, 4, 0);
+    painterGrid->addWidget(mSmoothFactorCombobox, 4, 1, Qt::AlignLeft);
+    painterGrid->addWidget(mPathToleranceLabel, 5, 0);
+    painterGrid->addWidget(mPathToleranceSpinBox, 5, 1, Qt::AlignLeft);
+    painterGrid->setRowMinimumHeight(6, 15);
+    painterGrid->addWidget(mTextFontLabel, 7, 0);
+    painterGrid->addWidget(mTextFontCombobox, 7, 1);
+    painterGrid->addWidget(mTextBoldButton, 7, 2);
+    painterGrid->addWidget(mTextItalicButton, 7, 3);
+    painterGrid->addWidget(mTextUnderlineButton, 7, 4);
+    painterGrid->addWidget(mNumberFontLabel, 8, 0);
+    painterGrid->addWidget(mNumberFontCombobox, 8, 1);
 
     auto painterGrpBox = new QGroupBox(tr("Painter Settings"));
     painterGrpBox->setLayout(painterGrid);
@@ -50,6 +50,7 @@ private:
     QCheckBox       *mImgurAlwaysCopyToClipboardCheckBox;
     QCheckBox       *mSmoothPathCheckbox;
     QCheckBox       *mItemShadowCheckbox;
+    QCheckBox       *mRedactBlurCheckbox;
     QCheckBox       *mCursorRulerCheckbox;
     QCheckBox       *mCursorInfoCheckbox;
     QLineEdit       *mSaveLocationLineEdit;
@@ -62,11 +63,13 @@ private:
     QLabel          *mTextFontLabel;
     QLabel          *mNumberFontLabel;
     QLabel          *mSmoothFactorLabel;
+    QLabel          *mPathToleranceLabel;
     QLabel          *mSnippingCursorSizeLabel;
     QLabel          *mSnippingCursorColorLabel;
     NumericComboBox *mCaptureDelayCombobox;
     NumericComboBox *mSmoothFactorCombobox;
     NumericComboBox *mSnippingCursorSizeCombobox;
+    QDoubleSpinBox  *mPathToleranceSpinBox;
     QFontComboBox   *mTextFontCombobox;
     QFontComboBox   *mNumberFontCombobox;
     QPushButton     *mBrowseButton;
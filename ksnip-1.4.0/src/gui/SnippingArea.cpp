@@ -21,7 +21,8 @@
 SnippingArea::SnippingArea(QWidget* parent) : QWidget(parent),
     mCursorFactory(new CursorFactory()),
     mConfig(KsnipConfig::instance()),
-    mBackground(nullptr)
+    mBackground(nullptr),
+    mDimmedBackground(nullptr)
 {
     // Make the frame span across the screen and show above any other widget
     setWindowFlags(Qt::WindowStaysOnTopHint | Qt::FramelessWindowHint | Qt::Tool | Qt::X11BypassWindowManagerHint);
@@ -33,6 +34,7 @@ SnippingArea::~SnippingArea()
 {
     delete mCursorFactory;
     delete mBackground;
+    delete mDimmedBackground;
 }
 
 void SnippingArea::showWithoutBackground()
@@ -63,17 +65,26 @@ void SnippingArea::show()
     grabKeyboard(); // Issue #57
 }
 
+/*
+ * Besides the background itself a dimmed copy is kept, so the dim overlay is
+ * composited only once and not on every repaint while selecting.
+ */
 void SnippingArea::setBackgroundImage(const QPixmap& background)
 {
     clearBackgroundImage();
     mBackground = new QPixmap(background);
+    mDimmedBackground = new QPixmap(background);
+
+    QPainter painter(mDimmedBackground);
+    painter.fillRect(mDimmedBackground->rect(), mDimColor);
 }
 
 void SnippingArea::clearBackgroundImage()
 {
-    if (mBackground != nullptr) {
-        delete mBackground;
-    }
+    delete mBackground;
+    delete mDimmedBackground;
+    mBackground = nullptr;
+    mDimmedBackground = nullptr;
 }
 
 void SnippingArea::init()
@@ -82,6 +93,7 @@ void SnippingArea::init()
     mCursorInfoEnabled = mConfig->cursorInfoEnabled();
     setMouseTracking(mCursorRulerEnabled || mCursorInfoEnabled);
     mMouseIsDown = false;
+    mCursorPosition = QCursor::pos();
 }
 
 void SnippingArea::mousePressEvent(QMouseEvent* event)
@@ -90,9 +102,11 @@ void SnippingArea::mousePressEvent(QMouseEvent* event)
         return;
     }
 
+    auto oldRegion = decorationRegion();
     mMouseDownPosition = event->pos();
     updateCapturedArea(mMouseDownPosition, event->pos());
     mMouseIsDown = true;
+    update(oldRegion.united(decorationRegion()));
 }
 
 void SnippingArea::mouseReleaseEvent(QMouseEvent* event)
@@ -112,29 +126,54 @@ bool SnippingArea::close()
     return QWidget::close();
 }
 
+/*
+ * Only the area covered by the decoration before and after the move is
+ * repainted, that is the selection with its size info or the ruler lines and
+ * the position info box.
+ */
 void SnippingArea::mouseMoveEvent(QMouseEvent* event)
 {
+    auto oldRegion = decorationRegion();
+    mCursorPosition = QCursor::pos();
     if (mMouseIsDown) {
         updateCapturedArea(mMouseDownPosition, event->pos());
     }
-    update();
+    update(oldRegion.united(decorationRegion()));
     QWidget::mouseMoveEvent(event);
 }
 
 void SnippingArea::paintEvent(QPaintEvent* event)
 {
     QPainter painter(this);
-
-    if (mBackground != nullptr) {
-        painter.drawPixmap(geometry(), *mBackground);
-    }
+    // Only the rects of the update region are drawn, the bounding rect of two
+    // small distant updates could cover most of the screen.
+    auto updateRects = event->region().rects();
+    auto dimmedRegion = event->region();
 
     if (mMouseIsDown) {
-        painter.setClipRegion(QRegion(geometry()).subtracted(QRegion(mCaptureArea)));
+        dimmedRegion = dimmedRegion.subtracted(QRegion(mCaptureArea));
     }
 
-    painter.setBrush(QColor(0, 0, 0, 150));
-    painter.drawRect(geometry());
+    if (mBackground != nullptr) {
+        if (mMouseIsDown) {
+            for (const auto& updateRect : updateRects) {
+                auto selectedRect = updateRect.intersected(mCaptureArea);
+                if (!selectedRect.isEmpty()) {
+                    painter.drawPixmap(selectedRect, *mBackground, backgroundSourceRect(selectedRect));
+                }
+            }
+        }
+        painter.setClipRegion(dimmedRegion);
+        for (const auto& updateRect : updateRects) {
+            painter.drawPixmap(updateRect, *mDimmedBackground, backgroundSourceRect(updateRect));
+        }
+    } else {
+        painter.setClipRegion(dimmedRegion);
+        for (const auto& updateRect : updateRects) {
+            painter.fillRect(updateRect, mDimColor);
+        }
+    }
+    painter.setClipping(false);
 
     if (mCursorRulerEnabled && !mMouseIsDown) {
         drawCursorRuler(painter);
@@ -170,6 +209,54 @@ void SnippingArea::updateCapturedArea(const QPoint& pos1, const QPoint& pos2)
     mCaptureArea = MathHelper::getRectBetweenTwoPoints(pos1, pos2);
 }
 
+/*
+ * Returns the area that is covered by the painted decoration in the current
+ * state, used to limit repaints to what has actually changed.
+ */
+QRegion SnippingArea::decorationRegion() const
+{
+    QRegion region;
+
+    if (mMouseIsDown) {
+        region += mCaptureArea.adjusted(-mSizeInfoMargin, -mSizeInfoMargin, 3, 3);
+        return region;
+    }
+
+    if (mCursorRulerEnabled) {
+        region += QRect(0, mCursorPosition.y() - 1, width(), 3);
+        region += QRect(mCursorPosition.x() - 1, 0, 3, height());
+    }
+
+    if (mCursorInfoEnabled) {
+        region += positionInfoRect(fontMetrics()).adjusted(-2, -2, 2, 2);
+    }
+
+    return region;
+}
+
+/*
+ * Maps a rect in widget coordinates to the background pixmap, which can differ
+ * in size when device pixels don't match widget pixels.
+ */
+QRect SnippingArea::backgroundSourceRect(const QRect& rect) const
+{
+    auto xRatio = (qreal)mBackground->width() / width();
+    auto yRatio = (qreal)mBackground->height() / height();
+    return QRectF(rect.x() * xRatio,
+                  rect.y() * yRatio,
+                  rect.width() * xRatio,
+                  rect.height() * yRatio).toAlignedRect();
+}
+
+QRect SnippingArea::positionInfoRect(const QFontMetrics& fontMetrics) const
+{
+    QPoint textOffset(10, 8);
+    auto text = createPositionInfoText(mCursorPosition.x(), mCursorPosition.y());
+    auto textBoundingRect = fontMetrics.boundingRect(text);
+    textBoundingRect.moveTopLeft(mCursorPosition + textOffset);
+    return textBoundingRect.adjusted(-3, 0, 7, 4);
+}
+
 QString SnippingArea::createPositionInfoText(int number1, int number2) const
 {
     return QString::number(number1) + ", " + QString::number(number2);
@@ -177,12 +264,12 @@ QString SnippingArea::createPositionInfoText(int number1, int number2) const
 
 void SnippingArea::drawCursorRuler(QPainter& painter) const
 {
-    auto pos = QCursor::pos();
+    auto pos = mCursorPosition;
     int offset = 4;
-    QLine midToTop(QPoint(pos.x(), pos.y() - offset), QPoint(pos.x(), geometry().top()));
-    QLine midToRight(QPoint(pos.x() + offset, pos.y()), QPoint(geometry().right(), pos.y()));
-    QLine midToBottom(QPoint(pos.x(), pos.y() + offset), QPoint(pos.x(), geometry().bottom()));
-    QLine midToLeft(QPoint(pos.x() - offset, pos.y()), QPoint(geometry().left(), pos.y()));
+    QLine midToTop(QPoint(pos.x(), pos.y() - offset), QPoint(pos.x(), rect().top()));
+    QLine midToRight(QPoint(pos.x() + offset, pos.y()), QPoint(rect().right(), pos.y()));
+    QLine midToBottom(QPoint(pos.x(), pos.y() + offset), QPoint(pos.x(), rect().bottom()));
+    QLine midToLeft(QPoint(pos.x() - offset, pos.y()), QPoint(rect().left(), pos.y()));
 
     painter.setPen(QPen(Qt::red, 1, Qt::DotLine, Qt::SquareCap, Qt::MiterJoin));
     painter.drawLine(midToTop);
@@ -194,7 +281,7 @@ void SnippingArea::drawCursorRuler(QPainter& painter) const
 void SnippingArea::drawCursorPositionInfo(QPainter& painter) const
 {
     QPoint textOffset(10, 8);
-    auto pos = QCursor::pos();
+    auto pos = mCursorPosition;
     auto text = createPositionInfoText(pos.x(), pos.y());
     auto textBoundingRect = getTextBounding(painter, text);
     textBoundingRect.moveTopLeft(pos + textOffset);
@@ -60,12 +60,19 @@ private:
     CursorFactory *mCursorFactory;
     KsnipConfig   *mConfig;
     QPixmap       *mBackground;
+    QPixmap       *mDimmedBackground;
+    QPoint         mCursorPosition;
+    const QColor   mDimColor = QColor(0, 0, 0, 150);
+    const int      mSizeInfoMargin = 100;
 
     void show();
     void setBackgroundImage(const QPixmap &background);
     void clearBackgroundImage();
     void init();
     void updateCapturedArea(const QPoint &pos1, const QPoint &pos2);
+    QRegion decorationRegion() const;
+    QRect backgroundSourceRect(const QRect &rect) const;
+    QRect positionInfoRect(const QFontMetrics &fontMetrics) const;
     QString createPositionInfoText(int number1, int number2) const;
     void drawCursorRuler(QPainter &painter) const;
     void drawCursorPositionInfo(QPainter &painter) const;
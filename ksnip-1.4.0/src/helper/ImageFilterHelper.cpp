@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "ImageFilterHelper.h"
+
+/*
+ * Returns the given rect of a 32 bit image with every block replaced by its
+ * average color. Blocks are aligned to the image and not to the rect, so
+ * adjacent rects can be pixelated separately and still fit together.
+ */
+QImage ImageFilterHelper::pixelate(const QImage& image, const QRect& rect, int blockSize)
+{
+    auto area = rect & image.rect();
+    QImage result(area.size(), image.format());
+    blockSize = qMax(blockSize, 1);
+
+    auto firstX = area.left() - area.left() % blockSize;
+    auto firstY = area.top() - area.top() % blockSize;
+    for (auto y = firstY; y <= area.bottom(); y += blockSize) {
+        for (auto x = firstX; x <= area.right(); x += blockSize) {
+            auto block = QRect(x, y, blockSize, blockSize) & image.rect();
+            quint32 sum[4] = { 0, 0, 0, 0 };
+            for (auto row = block.top(); row <= block.bottom(); row++) {
+                auto pixel = image.constScanLine(row) + block.left() * 4;
+                for (auto i = 0; i < block.width() * 4; i++) {
+                    sum[i % 4] += pixel[i];
+                }
+            }
+
+            auto count = block.width() * block.height();
+            uchar average[4];
+            for (auto i = 0; i < 4; i++) {
+                average[i] = sum[i] / count;
+            }
+
+            auto target = (block & area).translated(-area.topLeft());
+            for (auto row = target.top(); row <= target.bottom(); row++) {
+                auto pixel = result.scanLine(row) + target.left() * 4;
+                for (auto i = 0; i < target.width() * 4; i++) {
+                    pixel[i] = average[i % 4];
+                }
+            }
+        }
+    }
+    return result;
+}
+
+/*
+ * Blurs a 32 bit image in place with repeated separable box filters, two
+ * passes come close to a tent and three to a gaussian filter. Pixels outside
+ * the image are treated as copies of the closest edge pixel.
+ */
+void ImageFilterHelper::boxBlur(QImage& image, int radius, int passes)
+{
+    if (radius < 1 || image.isNull()) {
+        return;
+    }
+
+    for (auto i = 0; i < passes; i++) {
+        blurRows(image, radius);
+        blurColumns(image, radius);
+    }
+}
+
+/*
+ * Keeps the larger value of every channel of both 32 bit images, the other
+ * image is placed at the given position and clipped to the image.
+ */
+void ImageFilterHelper::combineMaximum(QImage& image, const QImage& other, const QPoint& position)
+{
+    auto rect = QRect(position, other.size()) & image.rect();
+    auto count = rect.width() * 4;
+
+    for (auto y = rect.top(); y <= rect.bottom(); y++) {
+        auto output = image.scanLine(y) + rect.left() * 4;
+        auto input = other.constScanLine(y - position.y()) + (rect.left() - position.x()) * 4;
+        for (auto i = 0; i < count; i++) {
+            output[i] = qMax(output[i], input[i]);
+        }
+    }
+}
+
+//
+// Private Functions
+//
+
+/*
+ * Running sum over each row, the four channels of a pixel are summed side by
+ * side so the compiler can keep them in one vector register.
+ */
+void ImageFilterHelper::blurRows(QImage& image, int radius)
+{
+    auto width = image.width();
+    auto multiplier = 65536 / (2 * radius + 1);
+    QVector<uchar> source(width * 4);
+
+    for (auto y = 0; y < image.height(); y++) {
+        auto line = image.scanLine(y);
+        memcpy(source.data(), line, width * 4);
+        auto input = source.constData();
+
+        quint32 sum[4];
+        for (auto c = 0; c < 4; c++) {
+            sum[c] = input[c] * (radius + 1);
+        }
+        for (auto x = 1; x <= radius; x++) {
+            auto pixel = input + qMin(x, width - 1) * 4;
+            for (auto c = 0; c < 4; c++) {
+                sum[c] += pixel[c];
+            }
+        }
+
+        for (auto x = 0; x < width; x++) {
+            auto added = input + qMin(x + radius + 1, width - 1) * 4;
+            auto removed = input + qMax(x - radius, 0) * 4;
+            auto output = line + x * 4;
+            for (auto c = 0; c < 4; c++) {
+                output[c] = (sum[c] * multiplier) >> 16;
+                sum[c] += added[c] - removed[c];
+            }
+        }
+    }
+}
+
+/*
+ * Running sum over all columns at once, every step walks a whole row so the
+ * inner loops are long, contiguous and free of dependencies between columns.
+ */
+void ImageFilterHelper::blurColumns(QImage& image, int radius)
+{
+    auto height = image.height();
+    auto count = image.width() * 4;
+    auto multiplier = 65536 / (2 * radius + 1);
+    auto source = image.copy();
+    QVector<quint32> sums(count);
+    auto sum = sums.data();
+
+    auto first = source.constScanLine(0);
+    for (auto i = 0; i < count; i++) {
+        sum[i] = first[i] * (radius + 1);
+    }
+    for (auto y = 1; y <= radius; y++) {
+        auto line = source.constScanLine(qMin(y, height - 1));
+        for (auto i = 0; i < count; i++) {
+            sum[i] += line[i];
+        }
+    }
+
+    for (auto y = 0; y < height; y++) {
+        auto added = source.constScanLine(qMin(y + radius + 1, height - 1));
+        auto removed = source.constScanLine(qMax(y - radius, 0));
+        auto output = image.scanLine(y);
+        for (auto i = 0; i < count; i++) {
+            output[i] = (sum[i] * multiplier) >> 16;
+            sum[i] += added[i] - removed[i];
+        }
+    }
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef IMAGEFILTERHELPER_H
+#define IMAGEFILTERHELPER_H
+
+#include <QImage>
+#include <QRect>
+#include <QVector>
+
+class ImageFilterHelper
+{
+public:
+    static QImage pixelate(const QImage &image, const QRect &rect, int blockSize);
+    static void boxBlur(QImage &image, int radius, int passes = 2);
+    static void combineMaximum(QImage &image, const QImage &other, const QPoint &position);
+
+private:
+    static void blurRows(QImage &image, int radius);
+    static void blurColumns(QImage &image, int radius);
+};
+
+#endif // IMAGEFILTERHELPER_H
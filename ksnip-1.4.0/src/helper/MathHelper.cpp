@@ -26,6 +26,22 @@ qreal MathHelper::distanceBetweenPoints(const QPointF& point1, const QPointF& po
     return qSqrt(horizontalDistance + verticalDistance);
 }
 
+/*
+ * Squared distance between the point and the closest point on the line
+ * segment, squared so callers can compare it without taking a square root.
+ */
+qreal MathHelper::squaredDistanceToLine(const QPointF& point, const QPointF& lineStart, const QPointF& lineEnd)
+{
+    auto line = lineEnd - lineStart;
+    auto lengthSquared = QPointF::dotProduct(line, line);
+    auto ratio = 0.0;
+    if (lengthSquared > 0) {
+        ratio = qBound(0.0, QPointF::dotProduct(point - lineStart, line) / lengthSquared, 1.0);
+    }
+    auto distance = point - (lineStart + ratio * line);
+    return QPointF::dotProduct(distance, distance);
+}
+
 QPointF MathHelper::getBeginOfRounding(const QPointF& point1, const QPointF& point2)
 {
     QPointF startPoint;
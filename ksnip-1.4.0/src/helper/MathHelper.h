@@ -29,6 +29,7 @@ class MathHelper
 {
 public:
     static qreal distanceBetweenPoints(const QPointF& point1, const QPointF& point2);
+    static qreal squaredDistanceToLine(const QPointF& point, const QPointF& lineStart, const QPointF& lineEnd);
     static QPointF getBeginOfRounding(const QPointF& point1, const QPointF& point2);
     static QPointF getEndOfRounding(const QPointF& point1, const QPointF& point2);
     static qreal smallerValue(qreal value1, qreal value2);
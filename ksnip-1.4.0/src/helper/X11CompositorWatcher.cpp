@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "X11CompositorWatcher.h"
+
+X11CompositorWatcher::X11CompositorWatcher() :
+    mXFixesFirstEvent(0),
+    mIsWatching(false),
+    mIsCompositorActive(false)
+{
+    // A compositing manager owns the _NET_WM_CM_Sn selection of the screen it
+    // manages, see the EWMH spec.
+    auto atomName = QByteArray("_NET_WM_CM_S") + QByteArray::number(QX11Info::appScreen());
+    mSelectionAtom = X11GraphicsHelper::internAtom(atomName);
+
+    mIsWatching = startWatching();
+    mIsCompositorActive = queryCompositorActive();
+}
+
+X11CompositorWatcher* X11CompositorWatcher::instance()
+{
+    static X11CompositorWatcher instance;
+    return &instance;
+}
+
+/*
+ * Returns the cached compositor state, which is kept up to date by XFixes
+ * selection notify events. Only when XFixes is not available the X server is
+ * asked on every call.
+ */
+bool X11CompositorWatcher::isCompositorActive()
+{
+    if (!mIsWatching) {
+        mIsCompositorActive = queryCompositorActive();
+    }
+    return mIsCompositorActive;
+}
+
+bool X11CompositorWatcher::nativeEventFilter(const QByteArray& eventType, void* message, long*)
+{
+    if (eventType != "xcb_generic_event_t") {
+        return false;
+    }
+
+    auto event = static_cast<xcb_generic_event_t*>(message);
+    if ((event->response_type & ~0x80) != mXFixesFirstEvent + XCB_XFIXES_SELECTION_NOTIFY) {
+        return false;
+    }
+
+    auto notifyEvent = reinterpret_cast<xcb_xfixes_selection_notify_event_t*>(event);
+    if (notifyEvent->selection == mSelectionAtom) {
+        mIsCompositorActive = notifyEvent->subtype == XCB_XFIXES_SELECTION_EVENT_SET_SELECTION_OWNER
+                              && notifyEvent->owner != XCB_NONE;
+    }
+
+    // Never swallow the event, Qt listens to selection changes as well.
+    return false;
+}
+
+/*
+ * Subscribes to owner changes of the compositor selection on the root window.
+ * Returns false if the XFixes extension is not available.
+ */
+bool X11CompositorWatcher::startWatching()
+{
+    auto connection = QX11Info::connection();
+    if (!connection || !QCoreApplication::instance()) {
+        return false;
+    }
+
+    auto extension = xcb_get_extension_data(connection, &xcb_xfixes_id);
+    if (!extension || !extension->present) {
+        return false;
+    }
+    mXFixesFirstEvent = extension->first_event;
+
+    auto versionCookie = xcb_xfixes_query_version(connection,
+                                                  XCB_XFIXES_MAJOR_VERSION,
+                                                  XCB_XFIXES_MINOR_VERSION);
+    ScopedCPointer<xcb_xfixes_query_version_reply_t> versionReply(xcb_xfixes_query_version_reply(connection, versionCookie, nullptr));
+    if (versionReply.isNull()) {
+        return false;
+    }
+
+    xcb_xfixes_select_selection_input(connection,
+                                      QX11Info::appRootWindow(),
+                                      mSelectionAtom,
+                                      XCB_XFIXES_SELECTION_EVENT_MASK_SET_SELECTION_OWNER |
+                                      XCB_XFIXES_SELECTION_EVENT_MASK_SELECTION_WINDOW_DESTROY |
+                                      XCB_XFIXES_SELECTION_EVENT_MASK_SELECTION_CLIENT_CLOSE);
+    xcb_flush(connection);
+
+    QCoreApplication::instance()->installNativeEventFilter(this);
+    return true;
+}
+
+bool X11CompositorWatcher::queryCompositorActive() const
+{
+    auto connection = QX11Info::connection();
+    if (!connection || mSelectionAtom == XCB_ATOM_NONE) {
+        return false;
+    }
+
+    auto ownerCookie = xcb_get_selection_owner(connection, mSelectionAtom);
+    ScopedCPointer<xcb_get_selection_owner_reply_t> ownerReply(xcb_get_selection_owner_reply(connection, ownerCookie, nullptr));
+    return !ownerReply.isNull() && ownerReply->owner != XCB_NONE;
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef X11COMPOSITORWATCHER_H
+#define X11COMPOSITORWATCHER_H
+
+#include <QAbstractNativeEventFilter>
+#include <QCoreApplication>
+
+#include "X11GraphicsHelper.h"
+
+class X11CompositorWatcher : public QAbstractNativeEventFilter
+{
+public:
+    static X11CompositorWatcher *instance();
+    bool isCompositorActive();
+    virtual bool nativeEventFilter(const QByteArray &eventType, void *message, long *result) override;
+
+private:
+    xcb_atom_t mSelectionAtom;
+    uint8_t    mXFixesFirstEvent;
+    bool       mIsWatching;
+    bool       mIsCompositorActive;
+
+    X11CompositorWatcher();
+    bool startWatching();
+    bool queryCompositorActive() const;
+};
+
+#endif // X11COMPOSITORWATCHER_H
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "X11DamageWatcher.h"
+
+X11DamageWatcher::X11DamageWatcher(QObject* parent) : QObject(parent),
+    mDamageFirstEvent(0),
+    mDamage(XCB_NONE)
+{
+    mIsAvailable = queryExtension();
+}
+
+X11DamageWatcher::~X11DamageWatcher()
+{
+    stop();
+}
+
+bool X11DamageWatcher::isAvailable() const
+{
+    return mIsAvailable;
+}
+
+/*
+ * Starts reporting damage of the given window, areas are reported relative to
+ * the window. Only growth of the bounding box of the damage is reported, so a
+ * busy screen doesn't send one event per drawing operation. The damage is
+ * collected on the server until reset() is called.
+ */
+bool X11DamageWatcher::watch(xcb_window_t window)
+{
+    if (!mIsAvailable || window == XCB_NONE) {
+        return false;
+    }
+
+    stop();
+
+    auto connection = QX11Info::connection();
+    mDamage = xcb_generate_id(connection);
+    auto cookie = xcb_damage_create_checked(connection,
+                                            mDamage,
+                                            window,
+                                            XCB_DAMAGE_REPORT_LEVEL_BOUNDING_BOX);
+    ScopedCPointer<xcb_generic_error_t> error(xcb_request_check(connection, cookie));
+    if (!error.isNull()) {
+        qWarning("X11DamageWatcher::watch: Unable to watch window %u, error code %d.",
+                 window, error->error_code);
+        mDamage = XCB_NONE;
+        return false;
+    }
+
+    QCoreApplication::instance()->installNativeEventFilter(this);
+    return true;
+}
+
+/*
+ * Clears the damage collected on the server, the next change is reported
+ * again. Called once the damaged areas were grabbed.
+ */
+void X11DamageWatcher::reset()
+{
+    if (mDamage == XCB_NONE) {
+        return;
+    }
+
+    auto connection = QX11Info::connection();
+    xcb_damage_subtract(connection, mDamage, XCB_NONE, XCB_NONE);
+    xcb_flush(connection);
+}
+
+void X11DamageWatcher::stop()
+{
+    if (mDamage == XCB_NONE) {
+        return;
+    }
+
+    QCoreApplication::instance()->removeNativeEventFilter(this);
+
+    auto connection = QX11Info::connection();
+    xcb_damage_destroy(connection, mDamage);
+    xcb_flush(connection);
+    mDamage = XCB_NONE;
+}
+
+bool X11DamageWatcher::nativeEventFilter(const QByteArray& eventType, void* message, long*)
+{
+    if (eventType != "xcb_generic_event_t") {
+        return false;
+    }
+
+    auto event = static_cast<xcb_generic_event_t*>(message);
+    if ((event->response_type & ~0x80) != mDamageFirstEvent + XCB_DAMAGE_NOTIFY) {
+        return false;
+    }
+
+    auto notifyEvent = reinterpret_cast<xcb_damage_notify_event_t*>(event);
+    if (notifyEvent->damage != mDamage) {
+        return false;
+    }
+
+    emit damaged(QRect(notifyEvent->area.x,
+                       notifyEvent->area.y,
+                       notifyEvent->area.width,
+                       notifyEvent->area.height));
+    return true;
+}
+
+//
+// Private Functions
+//
+
+/*
+ * The version has to be negotiated once before any other damage request is
+ * accepted by the X server.
+ */
+bool X11DamageWatcher::queryExtension()
+{
+    auto connection = QX11Info::connection();
+    if (!connection || !QCoreApplication::instance()) {
+        return false;
+    }
+
+    auto extension = xcb_get_extension_data(connection, &xcb_damage_id);
+    if (!extension || !extension->present) {
+        return false;
+    }
+    mDamageFirstEvent = extension->first_event;
+
+    auto versionCookie = xcb_damage_query_version(connection,
+                                                  XCB_DAMAGE_MAJOR_VERSION,
+                                                  XCB_DAMAGE_MINOR_VERSION);
+    ScopedCPointer<xcb_damage_query_version_reply_t> versionReply(xcb_damage_query_version_reply(connection, versionCookie, nullptr));
+    return !versionReply.isNull();
+}
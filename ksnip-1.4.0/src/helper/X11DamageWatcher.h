@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef X11DAMAGEWATCHER_H
+#define X11DAMAGEWATCHER_H
+
+#include <xcb/damage.h>
+
+#include <QObject>
+#include <QAbstractNativeEventFilter>
+#include <QCoreApplication>
+
+#include "X11GraphicsHelper.h"
+
+/*
+ * Reports the areas of a window, usually the root window, that were changed
+ * by drawing, based on the XDamage extension.
+ */
+class X11DamageWatcher : public QObject, public QAbstractNativeEventFilter
+{
+    Q_OBJECT
+public:
+    X11DamageWatcher(QObject *parent = 0);
+    ~X11DamageWatcher();
+    bool isAvailable() const;
+    bool watch(xcb_window_t window);
+    void reset();
+    void stop();
+    virtual bool nativeEventFilter(const QByteArray &eventType, void *message, long *result) override;
+
+signals:
+    void damaged(const QRect &area) const;
+
+private:
+    bool                mIsAvailable;
+    uint8_t             mDamageFirstEvent;
+    xcb_damage_damage_t mDamage;
+
+    bool queryExtension();
+};
+
+#endif // X11DAMAGEWATCHER_H
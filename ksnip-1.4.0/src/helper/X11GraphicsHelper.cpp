@@ -25,15 +25,6 @@
 
 #include "X11GraphicsHelper.h"
 
-#include <X11/Xlib.h>
-
-bool X11GraphicsHelper::isCompositorActive()
-{
-    auto display = XOpenDisplay(0);
-    auto prop_atom = XInternAtom(display, "_NET_WM_CM_S0", False);
-    return XGetSelectionOwner(display, prop_atom) != None;
-}
-
 QRect X11GraphicsHelper::getFullScreenRect()
 {
     return getWindowRect(QX11Info::appRootWindow());
@@ -99,12 +90,51 @@ QPoint X11GraphicsHelper::getNativeCursorPosition()
 
 // Note: x, y, width and height are measured in device pixels
 QPixmap X11GraphicsHelper::blendCursorImage(const QPixmap& pixmap, const QRect& rect)
+{
+    QPoint cursorPos;
+    auto cursorImage = getCursorImage(rect, &cursorPos);
+    if (cursorImage.isNull()) {
+        return pixmap;
+    }
+
+    QPixmap blendedPixmap = pixmap;
+    QPainter painter(&blendedPixmap);
+    painter.drawImage(cursorPos, cursorImage);
+
+    return blendedPixmap;
+}
+
+/*
+ * Paints the cursor straight into the image instead of a copy of it. Returns
+ * the part of the image that was painted over, empty if the cursor is not
+ * within the rect.
+ */
+QRect X11GraphicsHelper::blendCursorImage(QImage* image, const QRect& rect)
+{
+    QPoint cursorPos;
+    auto cursorImage = getCursorImage(rect, &cursorPos);
+    if (cursorImage.isNull()) {
+        return QRect();
+    }
+
+    QPainter painter(image);
+    painter.drawImage(cursorPos, cursorImage);
+
+    return QRect(cursorPos, cursorImage.size()) & image->rect();
+}
+
+/*
+ * Returns the current cursor image and sets position to where its top left
+ * corner is within the rect. Returns a null image if the cursor is not within
+ * the rect.
+ */
+QImage X11GraphicsHelper::getCursorImage(const QRect& rect, QPoint* position)
 {
     auto cursorPos = getNativeCursorPosition();
 
     // If cursor not within rect that we capture, then nothing to do here
     if (!rect.contains(cursorPos)) {
-        return pixmap;
+        return QImage();
     }
 
     // now we can get the image and start processing
@@ -113,30 +143,50 @@ QPixmap X11GraphicsHelper::blendCursorImage(const QPixmap& pixmap, const QRect&
     auto  cursorCookie = xcb_xfixes_get_cursor_image_unchecked(xcbConn);
     ScopedCPointer<xcb_xfixes_get_cursor_image_reply_t> cursorReply(xcb_xfixes_get_cursor_image_reply(xcbConn, cursorCookie, nullptr));
     if (cursorReply.isNull()) {
-        return pixmap;
+        return QImage();
     }
 
     auto pixelData = xcb_xfixes_get_cursor_image_cursor_image(cursorReply.data());
     if (!pixelData) {
-        return pixmap;
+        return QImage();
     }
 
-    // process the image into a QImage
+    // process the image into a QImage, the pixels belong to the reply so the
+    // small cursor image is copied
     QImage cursorImage = QImage((quint8*)pixelData,
                                 cursorReply->width,
                                 cursorReply->height,
-                                QImage::Format_ARGB32_Premultiplied);
+                                QImage::Format_ARGB32_Premultiplied).copy();
 
     // a small fix for the cursor position for fancier cursors
     cursorPos -= QPoint(cursorReply->xhot, cursorReply->yhot);
 
     // now we translate the cursor point to our screen rectangle
-    cursorPos -= QPoint(rect.x(), rect.y());
+    *position = cursorPos - QPoint(rect.x(), rect.y());
 
-    // and do the painting
-    QPixmap blendedPixmap = pixmap;
-    QPainter painter(&blendedPixmap);
-    painter.drawImage(cursorPos, cursorImage);
+    return cursorImage;
+}
 
-    return blendedPixmap;
+/*
+ * Returns the atom for the provided name, atoms never change during the
+ * lifetime of the X server, so every name is only interned once.
+ */
+xcb_atom_t X11GraphicsHelper::internAtom(const QByteArray& name)
+{
+    static QHash<QByteArray, xcb_atom_t> atomCache;
+
+    auto cachedAtom = atomCache.constFind(name);
+    if (cachedAtom != atomCache.constEnd()) {
+        return cachedAtom.value();
+    }
+
+    auto connection = QX11Info::connection();
+    auto atomCookie = xcb_intern_atom(connection, false, name.length(), name.constData());
+    ScopedCPointer<xcb_intern_atom_reply_t> atomReply(xcb_intern_atom_reply(connection, atomCookie, nullptr));
+    if (atomReply.isNull()) {
+        return XCB_ATOM_NONE;
+    }
+
+    atomCache.insert(name, atomReply->atom);
+    return atomReply->atom;
 }
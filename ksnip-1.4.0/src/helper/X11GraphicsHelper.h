@@ -26,17 +26,18 @@
 #include <QRect>
 #include <QPixmap>
 #include <QPainter>
+#include <QHash>
 
 class X11GraphicsHelper
 {
 public:
-    static bool isCompositorActive();
     static QRect getFullScreenRect();
     static QRect getActiveWindowRect();
     static QPoint getNativeCursorPosition();
     static QPixmap blendCursorImage(const QPixmap &pixmap, const QRect &rect);
-
-private:
+    static QRect blendCursorImage(QImage *image, const QRect &rect);
+    static QImage getCursorImage(const QRect &rect, QPoint *position);
+    static xcb_atom_t internAtom(const QByteArray &name);
     static QRect getWindowRect(xcb_window_t window);
     static xcb_window_t getActiveWindowId();
 };
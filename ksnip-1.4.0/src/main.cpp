@@ -19,23 +19,25 @@
 
 #include <QApplication>
 #include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include <csignal>
 
 #include "gui/MainWindow.h"
 #include "src/backend/ImageGrabber.h"
+#include "src/backend/CaptureServer.h"
+#include "src/backend/CaptureClient.h"
 
-int main(int argc, char** argv)
-{
-    QApplication app(argc, argv);
-    app.setAttribute(Qt::AA_UseHighDpiPixmaps);
+static volatile std::sig_atomic_t burstStopRequested = 0;
 
-    // Setup application properties
-    app.setOrganizationName("ksnip");
-    app.setOrganizationDomain("ksnip.local");
-    app.setApplicationName("ksnip");
-    app.setApplicationVersion("v1.4.0");
+static void requestBurstStop(int)
+{
+    burstStopRequested = 1;
+}
 
-    // Setup command line parser
-    QCommandLineParser parser;
+static void setupParser(QCommandLineParser &parser)
+{
     parser.setApplicationDescription(QCoreApplication::translate("main", "Ksnip Screenshot Tool"));
     parser.addHelpOption();
     parser.addVersionOption();
@@ -61,21 +63,28 @@ int main(int argc, char** argv)
         {   {"c", "cursor"},
             QCoreApplication::translate("main", "Capture mouse cursor on screenshot."),
         },
+        {   {"i", "interval"},
+            QCoreApplication::translate("main", "Take a screenshot every given number of milliseconds until the frame count is reached or ksnip is interrupted."),
+            QCoreApplication::translate("main", "milliseconds")
+        },
+        {   {"n", "frames"},
+            QCoreApplication::translate("main", "Number of screenshots taken with interval or watch, by default screenshots are taken until ksnip is interrupted."),
+            QCoreApplication::translate("main", "count")
+        },
+        {   {"w", "watch"},
+            QCoreApplication::translate("main", "Take a screenshot whenever the screen or the active window changed, until the frame count is reached or ksnip is interrupted."),
+        },
+        {   {"s", "scroll"},
+            QCoreApplication::translate("main", "Capture the active window while it is scrolled and stitch the frames, until the content stops moving or ksnip is interrupted."),
+        },
+        {   "daemon",
+            QCoreApplication::translate("main", "Keep running in the background and take the captures requested by other ksnip calls."),
+        },
     });
-    parser.process(app);
-
-    auto arguments = QCoreApplication::arguments();
-    MainWindow* window;
-
-    // If there are no options except the the ksnip executable name, just run
-    // the application
-    if (arguments.count() <= 1) {
-        window = new MainWindow(MainWindow::GUI);
-        return app.exec();
-    }
-    // If we have reached this point, we are running CLI mode
-    window = new MainWindow(MainWindow::CLI);
+}
 
+static bool parseCaptureRequest(const QCommandLineParser &parser, CaptureServer::Request *request)
+{
     // Check if delay was selected, if yes, make sure a valid number was provided
     int delay = 0;
     if (parser.isSet("d")) {
@@ -83,27 +92,192 @@ int main(int argc, char** argv)
         delay = parser.value("d").toInt(&delayValid);
         if (!delay) {
             qWarning("Please enter delay in seconds.");
-            return 1;
+            return false;
         }
     }
+    request->delay = delay * 1000;
 
     // Check if the user wants the mouse cursor to be included
-    bool cursor = parser.isSet("c");
-    ImageGrabber::CaptureMode mode;
+    request->captureCursor = parser.isSet("c");
 
     if (parser.isSet("r")) {
-        mode = ImageGrabber::RectArea;
+        request->captureMode = ImageGrabber::RectArea;
     } else if (parser.isSet("f")) {
-        mode = ImageGrabber::FullScreen;
+        request->captureMode = ImageGrabber::FullScreen;
     } else if (parser.isSet("m")) {
-        mode = ImageGrabber::CurrentScreen;
-    } else if (parser.isSet("a")) {
-        mode = ImageGrabber::ActiveWindow;
+        request->captureMode = ImageGrabber::CurrentScreen;
+    } else if (parser.isSet("a") || parser.isSet("s")) {
+        request->captureMode = ImageGrabber::ActiveWindow;
     } else {
         qWarning("Please select capture mode.");
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Hands the capture over to a running daemon, which saves the startup of the
+ * gui application and the main window. Only a core application is created for
+ * parsing the options. Returns false when no daemon was found.
+ */
+static bool forwardToDaemon(int argc, char** argv, const QElapsedTimer &timer, int *result)
+{
+    // Runs before any application object exists, the regular startup must be
+    // able to create its own.
+    QStringList arguments;
+    for (auto i = 0; i < argc; i++) {
+        arguments.append(QString::fromLocal8Bit(argv[i]));
+    }
+
+    QCommandLineParser parser;
+    setupParser(parser);
+
+    // Anything that isn't a plain capture request, including invalid
+    // options, is left to the regular startup.
+    if (arguments.count() <= 1 ||
+            !parser.parse(arguments) ||
+            parser.isSet("h") ||
+            parser.isSet("v") ||
+            parser.isSet("i") ||
+            parser.isSet("w") ||
+            parser.isSet("s") ||
+            parser.isSet("daemon")) {
+        return false;
+    }
+
+    CaptureServer::Request request;
+    if (!parseCaptureRequest(parser, &request)) {
+        *result = 1;
+        return true;
+    }
+
+    CaptureClient client;
+    if (!client.connectToDaemon()) {
+        return false;
+    }
+
+    // Only the socket needs an application object, a plain core application
+    // is enough and doesn't connect to the display.
+    QCoreApplication app(argc, argv);
+    auto success = client.capture(request);
+    if (success) {
+        qInfo("Screenshot saved to: %s", qPrintable(client.path()));
+    }
+    qCDebug(ksnipDaemon, "Capture written by daemon after %lld ms", timer.elapsed());
+    *result = success ? 0 : 1;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    QElapsedTimer captureTimer;
+    captureTimer.start();
+
+    int result;
+    if (forwardToDaemon(argc, argv, captureTimer, &result)) {
+        return result;
+    }
+
+    QApplication app(argc, argv);
+    app.setAttribute(Qt::AA_UseHighDpiPixmaps);
+
+    // Setup application properties
+    app.setOrganizationName("ksnip");
+    app.setOrganizationDomain("ksnip.local");
+    app.setApplicationName("ksnip");
+    app.setApplicationVersion("v1.4.0");
+
+    // Setup command line parser
+    QCommandLineParser parser;
+    setupParser(parser);
+    parser.process(app);
+
+    auto arguments = QCoreApplication::arguments();
+    MainWindow* window;
+
+    // In daemon mode we only wait for capture requests, the snipping area
+    // closing must not quit the application.
+    if (parser.isSet("daemon")) {
+        app.setQuitOnLastWindowClosed(false);
+        window = new MainWindow(MainWindow::Daemon);
+        auto server = new CaptureServer(window);
+        if (!server->listen()) {
+            return 1;
+        }
+        QObject::connect(server, &CaptureServer::captureRequested,
+                         window, &MainWindow::instantCapture);
+        QObject::connect(window, &MainWindow::captureFinished,
+                         server, &CaptureServer::captureFinished);
+        return app.exec();
+    }
+
+    // If there are no options except the the ksnip executable name, just run
+    // the application
+    if (arguments.count() <= 1) {
+        qCDebug(ksnipStartup, "Created application in %lld ms", captureTimer.elapsed());
+        window = new MainWindow(MainWindow::GUI);
+        return app.exec();
+    }
+
+    CaptureServer::Request request;
+    if (!parseCaptureRequest(parser, &request)) {
         return 1;
     }
 
-    window->instantCapture(mode, cursor, delay * 1000);
+    // Interval, watching and scrolling captures run until they are done or
+    // until we receive SIGINT or SIGTERM, the signal handler only sets a flag
+    // which is polled here.
+    if (parser.isSet("i") || parser.isSet("w") || parser.isSet("s")) {
+        bool intervalValid = true;
+        auto interval = parser.isSet("i") ? parser.value("i").toInt(&intervalValid) : 0;
+        if (!intervalValid || (parser.isSet("i") && interval <= 0)) {
+            qWarning("Please enter interval in milliseconds.");
+            return 1;
+        }
+
+        bool frameCountValid = true;
+        auto frameCount = parser.isSet("n") ? parser.value("n").toInt(&frameCountValid) : 0;
+        if (!frameCountValid || frameCount < 0) {
+            qWarning("Please enter number of frames.");
+            return 1;
+        }
+
+        window = new MainWindow(MainWindow::CLI);
+        std::signal(SIGINT, requestBurstStop);
+        std::signal(SIGTERM, requestBurstStop);
+
+        QTimer stopTimer;
+        QObject::connect(&stopTimer, &QTimer::timeout, [&stopTimer, window]() {
+            if (burstStopRequested) {
+                stopTimer.stop();
+                window->stopBurst();
+            }
+        });
+        stopTimer.start(100);
+
+        if (parser.isSet("s")) {
+            window->instantScroll(request.delay);
+        } else if (parser.isSet("w")) {
+            window->instantWatch(request.captureMode,
+                                 request.captureCursor,
+                                 request.delay,
+                                 frameCount);
+        } else {
+            window->instantBurst(request.captureMode,
+                                 request.captureCursor,
+                                 request.delay,
+                                 interval,
+                                 frameCount);
+        }
+        return app.exec();
+    }
+
+    // If we have reached this point, we are running CLI mode
+    window = new MainWindow(MainWindow::CLI);
+    QObject::connect(window, &MainWindow::captureFinished, [&captureTimer]() {
+        qCDebug(ksnipDaemon, "Capture written in process after %lld ms", captureTimer.elapsed());
+    });
+
+    window->instantCapture(request.captureMode, request.captureCursor, request.delay);
     return app.exec();
 }
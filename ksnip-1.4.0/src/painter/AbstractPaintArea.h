@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef ABSTRACTPAINTAREA_H
+#define ABSTRACTPAINTAREA_H
+
+#include <QGraphicsScene>
+#include <QImage>
+
+class AbstractPainterItem;
+
+/*
+ * The part of the PaintArea painter items talk to. Items report their changes
+ * through it and redactions read the capture, without depending on the
+ * PaintArea, which itself depends on all items.
+ */
+class AbstractPaintArea : public QGraphicsScene
+{
+public:
+    AbstractPaintArea() : QGraphicsScene() {}
+    virtual const QImage &capture() = 0;
+    virtual bool isValid() const = 0;
+    virtual void itemChanged(AbstractPainterItem *item) = 0;
+    virtual void itemRemoved(AbstractPainterItem *item) = 0;
+};
+
+#endif // ABSTRACTPAINTAREA_H
@@ -21,7 +21,9 @@
 
 int AbstractPainterItem::mOrder = 1;
 
-AbstractPainterItem::AbstractPainterItem(const QPen& attributes)
+AbstractPainterItem::AbstractPainterItem(const QPen& attributes) :
+    mHasShadow(false),
+    mSpillOffset(-1)
 {
     mAttributes = attributes;
     mSelectAttributes.setColor(Qt::red);
@@ -34,15 +36,18 @@ AbstractPainterItem::AbstractPainterItem(const AbstractPainterItem& other)
 {
     this->mAttributes = other.mAttributes;
     this->mSelectAttributes = other.mSelectAttributes;
-    if (other.graphicsEffect()) {
-        this->addShadowEffect();
-    }
+    this->mHasShadow = other.mHasShadow;
+    this->mSpillOffset = -1;
     this->setSelectable(other.selectable());
     this->setOffset(other.offset());
 }
 
 AbstractPainterItem::~AbstractPainterItem()
 {
+    auto area = paintArea();
+    if (area) {
+        area->itemRemoved(this);
+    }
     mOrder--;
 }
 
@@ -132,16 +137,75 @@ const QPen& AbstractPainterItem::selectColor() const
     return mSelectAttributes;
 }
 
+/*
+ * Shadows are not painted by the item itself but by the ShadowLayer of the
+ * PaintArea, which paints and caches the shadows of all items.
+ */
 void AbstractPainterItem::addShadowEffect()
 {
-    auto shadowEffect = dynamic_cast<QGraphicsDropShadowEffect*>(graphicsEffect());
-    if(!shadowEffect) {
-        shadowEffect = new QGraphicsDropShadowEffect();
-        shadowEffect->setColor(QColor(63, 63, 63, 190));
-        shadowEffect->setBlurRadius(7);
-        shadowEffect->setOffset(QPoint(2, 2));
-        this->setGraphicsEffect(shadowEffect);
+    if (mHasShadow) {
+        return;
+    }
+    prepareGeometryChange();
+    mHasShadow = true;
+}
+
+bool AbstractPainterItem::hasShadow() const
+{
+    return mHasShadow;
+}
+
+/*
+ * Rough amount of memory held by the item, used for limiting the memory kept
+ * alive by the undo history. Items holding large data should override it.
+ */
+qint64 AbstractPainterItem::byteCount() const
+{
+    return sizeof(AbstractPainterItem);
+}
+
+/*
+ * Called for items that are held by the undo history only, items can release
+ * data here that they are able to rebuild when they are shown again.
+ */
+void AbstractPainterItem::releaseCaches()
+{
+}
+
+/*
+ * Appends the data of an item that is held by the undo history only to the
+ * device and releases it, see writeSpill(). The item must be restored from
+ * the same device before it's shown again.
+ */
+void AbstractPainterItem::spill(QIODevice* device)
+{
+    if (isSpilled() || scene()) {
+        return;
+    }
+
+    auto offset = device->size();
+    if (!device->seek(offset)) {
+        return;
+    }
+    QDataStream stream(device);
+    if (writeSpill(stream)) {
+        mSpillOffset = offset;
+    }
+}
+
+void AbstractPainterItem::restore(QIODevice* device)
+{
+    if (!isSpilled() || !device->seek(mSpillOffset)) {
+        return;
     }
+    QDataStream stream(device);
+    readSpill(stream);
+    mSpillOffset = -1;
+}
+
+bool AbstractPainterItem::isSpilled() const
+{
+    return mSpillOffset >= 0;
 }
 
 /*
@@ -170,3 +234,56 @@ void AbstractPainterItem::paintDecoration(QPainter* painter)
         painter->drawRect(boundingRect());
     }
 }
+
+/*
+ * Hides QGraphicsItem::prepareGeometryChange() so every change in look or
+ * geometry of a painter item is reported to the PaintArea before it happens,
+ * which uses it to keep track of the dirty regions in the export buffer.
+ */
+void AbstractPainterItem::prepareGeometryChange()
+{
+    auto area = paintArea();
+    if (area) {
+        area->itemChanged(this);
+    }
+    QGraphicsItem::prepareGeometryChange();
+}
+
+QVariant AbstractPainterItem::itemChange(GraphicsItemChange change, const QVariant& value)
+{
+    auto area = paintArea();
+    if (area) {
+        switch (change) {
+        case ItemSceneChange:
+            area->itemRemoved(this);
+            break;
+        case ItemSceneHasChanged:
+        case ItemSelectedChange:
+        case ItemVisibleChange:
+        case ItemZValueChange:
+            area->itemChanged(this);
+            break;
+        default:
+            break;
+        }
+    }
+    return QGraphicsItem::itemChange(change, value);
+}
+
+AbstractPaintArea* AbstractPainterItem::paintArea() const
+{
+    return dynamic_cast<AbstractPaintArea*>(scene());
+}
+
+/*
+ * Writes the data that is released while spilled and releases it. Returns
+ * false if nothing was released, for example when writing failed.
+ */
+bool AbstractPainterItem::writeSpill(QDataStream&)
+{
+    return false;
+}
+
+void AbstractPainterItem::readSpill(QDataStream&)
+{
+}
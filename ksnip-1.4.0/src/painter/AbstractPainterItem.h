@@ -21,9 +21,12 @@
 #define ABSTRACTPAINTERITEM_H
 
 #include <QGraphicsItem>
+#include <QDataStream>
+#include <QIODevice>
 #include <QPainter>
 #include <QPen>
-#include <QGraphicsDropShadowEffect>
+
+#include "AbstractPaintArea.h"
 
 class AbstractPainterItem :  public QGraphicsItem
 {
@@ -57,16 +60,29 @@ public:
     virtual void setSelectable(bool enabled);
     virtual const QPen &selectColor() const;
     virtual void addShadowEffect();
+    virtual bool hasShadow() const;
+    virtual qint64 byteCount() const;
+    virtual void releaseCaches();
+    void spill(QIODevice *device);
+    void restore(QIODevice *device);
+    bool isSpilled() const;
     static int order();
     static void resetOrder();
 
 protected:
     void paintDecoration(QPainter *painter);
+    void prepareGeometryChange();
+    virtual QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
+    AbstractPaintArea *paintArea() const;
+    virtual bool writeSpill(QDataStream &stream);
+    virtual void readSpill(QDataStream &stream);
 
 private:
     QPen    mAttributes;
     QPen    mSelectAttributes;
     QPointF mOffset;
+    bool    mHasShadow;
+    qint64  mSpillOffset;
 };
 
 #endif // ABSTRACTPAINTERITEM_H
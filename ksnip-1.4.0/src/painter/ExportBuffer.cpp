@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "ExportBuffer.h"
+
+ExportBuffer::ExportBuffer(QGraphicsScene* scene) :
+    mScene(scene),
+    mIsValid(false)
+{
+}
+
+/*
+ * Returns the flattened scene. Only tiles that were marked dirty since the last
+ * call are composited again, everything else is taken from the cached buffer.
+ * The whole buffer is only rendered when the scene rect has grown or the
+ * buffer was invalidated.
+ */
+QImage ExportBuffer::image()
+{
+    auto sceneRect = mScene->sceneRect().toAlignedRect();
+
+    // After a crop the pixels are already in the buffer, only the part that
+    // is still inside the scene rect is kept.
+    if (mIsValid && mImageRect != sceneRect && mImageRect.contains(sceneRect)) {
+        mImage = mImage.copy(sceneRect.translated(-mImageRect.topLeft()));
+        mImageRect = sceneRect;
+    }
+
+    if (!mIsValid || mImageRect != sceneRect) {
+        if (mImage.size() != sceneRect.size()) {
+            mImage = QImage(sceneRect.size(), QImage::Format_ARGB32);
+        }
+        mImageRect = sceneRect;
+        mDirtyRegion = QRegion(mImageRect);
+        mIsValid = true;
+        mItemRects.clear();
+        for (auto baseItem : mScene->items()) {
+            auto item = qgraphicsitem_cast<AbstractPainterItem*>(baseItem);
+            if (item) {
+                mItemRects.insert(item, item->mapRectToScene(item->boundingRect()));
+            }
+        }
+    } else {
+        for (auto item : mDirtyItems) {
+            auto itemRect = item->mapRectToScene(item->boundingRect());
+            mItemRects.insert(item, itemRect);
+            mDirtyRegion += alignToTiles(itemRect);
+        }
+    }
+    mDirtyItems.clear();
+
+    if (!mDirtyRegion.isEmpty()) {
+        renderRegion(mDirtyRegion.intersected(mImageRect));
+        mDirtyRegion = QRegion();
+    }
+
+    return mImage;
+}
+
+void ExportBuffer::invalidate()
+{
+    mIsValid = false;
+    mDirtyItems.clear();
+    mItemRects.clear();
+    mDirtyRegion = QRegion();
+}
+
+void ExportBuffer::markDirty(const QRectF& rect)
+{
+    if (!mIsValid) {
+        return;
+    }
+    mDirtyRegion += alignToTiles(rect);
+}
+
+/*
+ * Called before an item changes its geometry or look. The area the item covers
+ * in the buffer is marked dirty and the item is remembered so its new area is
+ * picked up on the next export. Only the first change after an export needs to
+ * be recorded, intermediate states were never rendered into the buffer.
+ */
+void ExportBuffer::markItemDirty(AbstractPainterItem* item)
+{
+    if (!mIsValid || mDirtyItems.contains(item)) {
+        return;
+    }
+    markDirty(item->mapRectToScene(item->boundingRect()));
+    mDirtyItems.insert(item);
+}
+
+/*
+ * Called when an item leaves the scene or gets destroyed, the area it covered
+ * is cleared on next export and the item pointer is not touched anymore. The
+ * area is taken from the last export, the item may be in its destructor where
+ * its geometry can't be queried anymore. An item that was not exported yet
+ * never reached the buffer, its old area was already marked dirty.
+ */
+void ExportBuffer::releaseItem(AbstractPainterItem* item)
+{
+    mDirtyItems.remove(item);
+    auto itemRect = mItemRects.take(item);
+    if (!itemRect.isNull()) {
+        markDirty(itemRect);
+    }
+}
+
+/*
+ * Grows the rect by a margin that covers drop shadows and selection decoration
+ * and snaps it to the tile grid so that many small changes end up in few
+ * rectangles.
+ */
+QRect ExportBuffer::alignToTiles(const QRectF& rect) const
+{
+    auto grownRect = rect.adjusted(-mDirtyMargin, -mDirtyMargin, mDirtyMargin, mDirtyMargin);
+    auto left = qFloor((grownRect.left() - mImageRect.left()) / mTileSize) * mTileSize;
+    auto top = qFloor((grownRect.top() - mImageRect.top()) / mTileSize) * mTileSize;
+    auto right = qCeil((grownRect.right() - mImageRect.left()) / mTileSize) * mTileSize;
+    auto bottom = qCeil((grownRect.bottom() - mImageRect.top()) / mTileSize) * mTileSize;
+
+    return QRect(QPoint(left, top), QPoint(right - 1, bottom - 1)).translated(mImageRect.topLeft());
+}
+
+void ExportBuffer::renderRegion(const QRegion& region)
+{
+    QPainter painter(&mImage);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    for (auto sourceRect : region.rects()) {
+        auto targetRect = sourceRect.translated(-mImageRect.topLeft());
+        painter.setClipRect(targetRect);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.fillRect(targetRect, Qt::transparent);
+        painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+        mScene->render(&painter, targetRect, sourceRect);
+    }
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef EXPORTBUFFER_H
+#define EXPORTBUFFER_H
+
+#include <QGraphicsScene>
+#include <QHash>
+#include <QImage>
+#include <QPainter>
+#include <QRegion>
+#include <QSet>
+#include <QtMath>
+
+#include "AbstractPainterItem.h"
+
+class ExportBuffer
+{
+public:
+    ExportBuffer(QGraphicsScene *scene);
+    QImage image();
+    void invalidate();
+    void markDirty(const QRectF &rect);
+    void markItemDirty(AbstractPainterItem *item);
+    void releaseItem(AbstractPainterItem *item);
+
+private:
+    QGraphicsScene             *mScene;
+    QImage                      mImage;
+    QRect                       mImageRect;
+    QRegion                     mDirtyRegion;
+    QSet<AbstractPainterItem *> mDirtyItems;
+    QHash<AbstractPainterItem *, QRectF> mItemRects;
+    bool                        mIsValid;
+    const int                   mTileSize = 128;
+    const int                   mDirtyMargin = 10;
+
+    QRect alignToTiles(const QRectF &rect) const;
+    void renderRegion(const QRegion &region);
+};
+
+#endif // EXPORTBUFFER_H
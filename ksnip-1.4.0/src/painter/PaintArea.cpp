@@ -18,21 +18,28 @@
 */
 #include "PaintArea.h"
 
-PaintArea::PaintArea() : QGraphicsScene(),
+PaintArea::PaintArea() : AbstractPaintArea(),
+    mIsEnabled(false),
     mScreenshot(nullptr),
+    mShadowLayer(nullptr),
     mCurrentItem(nullptr),
     mRubberBand(nullptr),
     mCursor(nullptr),
     mShiftPressed(false),
     mPaintMode(Painter::Pen),
     mUndoStack(new QUndoStack(this)),
+    mUndoFloor(0),
+    mSpillFile(nullptr),
     mUndoAction(nullptr),
     mRedoAction(nullptr),
     mConfig(KsnipConfig::instance()),
     mPainterItemFactory(new PainterItemFactory()),
-    mCursorFactory(new CursorFactory())
+    mCursorFactory(new CursorFactory()),
+    mExportBuffer(new ExportBuffer(this)),
+    mItemIndex(new PainterItemIndex())
 {
     connect(mConfig, &KsnipConfig::painterUpdated, this, &PaintArea::setCursor);
+    connect(mUndoStack, &QUndoStack::indexChanged, this, &PaintArea::updateUndoAction);
 }
 
 PaintArea::~PaintArea()
@@ -40,6 +47,9 @@ PaintArea::~PaintArea()
     delete mCursorFactory;
     delete mPainterItemFactory;
     delete mUndoStack;
+    deleteOrphanedItems();
+    delete mExportBuffer;
+    delete mItemIndex;
 }
 
 //
@@ -50,10 +60,26 @@ void PaintArea::loadCapture(const QPixmap& pixmap)
 {
     clearCurrentItem();
     mUndoStack->clear();
+    mCommands.clear();
+    mUndoFloor = 0;
+    if (mSpillFile) {
+        mSpillFile->resize(0);
+    }
+    mExportBuffer->invalidate();
+    deleteOrphanedItems();
+    // The layer is deleted with all other items, items that get deleted after
+    // it must not report to it anymore.
+    mShadowLayer = nullptr;
     clear();
     clearSelection();
+    mItemIndex->clear();
     AbstractPainterItem::resetOrder();
     mScreenshot = addPixmap(pixmap);
+    mCapture = QImage();
+    // Same z value as the capture but added later, so it stays above the
+    // capture and below all painter items when reordering.
+    mShadowLayer = new ShadowLayer(pixmap.rect());
+    addItem(mShadowLayer);
     setSceneRect(pixmap.rect());
 }
 
@@ -95,20 +121,29 @@ QImage PaintArea::exportAsImage()
 
     clearSelection();
 
-    QImage image(sceneRect().size().toSize(), QImage::Format_ARGB32);
-    image.fill(Qt::transparent);
+    return mExportBuffer->image();
+}
 
-    QPainter painter(&image);
-    painter.setRenderHint(QPainter::Antialiasing);
-    render(&painter);
-    return image;
+/*
+ * The capture as image for items that work with its pixels, converted only
+ * once per capture. The capture is placed at the scene origin, so scene
+ * coordinates are also image coordinates.
+ */
+const QImage& PaintArea::capture()
+{
+    if (mCapture.isNull() && isValid()) {
+        mCapture = mScreenshot->pixmap().toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+    return mCapture;
 }
 
 void PaintArea::setIsEnabled(bool enabled)
 {
     mIsEnabled = enabled;
-    mUndoAction->setEnabled(enabled);
-    mRedoAction->setEnabled(enabled);
+    updateUndoAction();
+    if (mRedoAction) {
+        mRedoAction->setEnabled(enabled);
+    }
     setCursor();
 }
 
@@ -137,18 +172,26 @@ bool PaintArea::isTextEditing() const
 
 void PaintArea::crop(const QRectF& rect)
 {
-    mUndoStack->push(new CropCommand(mScreenshot, rect, this));
+    pushCommand(new CropCommand(rect, this));
 }
 
+/*
+ * Position of the cropped area within the capture, scene coordinates don't
+ * change when cropping.
+ */
 QPointF PaintArea::cropOffset() const
 {
-    return mScreenshot->offset();
+    return sceneRect().topLeft();
 }
 
 QAction* PaintArea::getUndoAction()
 {
+    // Not created by the undo stack as commands below the undo floor were
+    // dropped and can't be undone anymore.
     if (!mUndoAction) {
-        mUndoAction = mUndoStack->createUndoAction(this, tr("Undo"));
+        mUndoAction = new QAction(tr("Undo"), this);
+        connect(mUndoAction, &QAction::triggered, this, &PaintArea::undo);
+        updateUndoAction();
     }
     return mUndoAction;
 }
@@ -161,15 +204,23 @@ QAction* PaintArea::getRedoAction()
     return mRedoAction;
 }
 
+/*
+ * The scene keeps track of selected items on its own, so only the selection
+ * needs to be brought into stacking order, not all items on the scene.
+ */
 QList<AbstractPainterItem*> PaintArea::selectedItems(Qt::SortOrder order) const
 {
     QList<AbstractPainterItem*> list;
-    for (auto item : items(order)) {
-        auto base = static_cast<AbstractPainterItem*>(item);
-        if (base && base->isSelected()) {
+    for (auto item : QGraphicsScene::selectedItems()) {
+        auto base = qgraphicsitem_cast<AbstractPainterItem*>(item);
+        if (base) {
             list.append(base);
         }
     }
+
+    std::sort(list.begin(), list.end(), [order](AbstractPainterItem * a, AbstractPainterItem * b) {
+        return order == Qt::AscendingOrder ? a->zValue() < b->zValue() : a->zValue() > b->zValue();
+    });
     return list;
 }
 
@@ -178,6 +229,86 @@ QList<AbstractPainterItem *> PaintArea::copiedItems() const
     return mCopiedItems;
 }
 
+/*
+ * Bytes held by all commands on the undo stack, see byteCount() of the single
+ * commands for what is accounted to them.
+ */
+qint64 PaintArea::undoMemoryUsage() const
+{
+    qint64 usage = 0;
+    for (auto command : mCommands) {
+        auto accountedCommand = dynamic_cast<AbstractUndoCommand*>(command);
+        if (accountedCommand) {
+            usage += accountedCommand->byteCount();
+        }
+    }
+    return usage;
+}
+
+/*
+ * Temporary file the undo history spills item data to, created on first use.
+ * Returns null if the file can't be created, nothing is spilled then.
+ */
+QIODevice* PaintArea::spillFile()
+{
+    if (!mSpillFile) {
+        mSpillFile = new QTemporaryFile(this);
+        if (!mSpillFile->open()) {
+            qWarning("PaintArea::spillFile: Failed to create %s for the undo history.",
+                     qPrintable(mSpillFile->fileTemplate()));
+        }
+    }
+    return mSpillFile->isOpen() ? mSpillFile : nullptr;
+}
+
+/*
+ * Takes over items of dropped undo commands. Items on the scene are deleted
+ * with the scene, items that were deleted by a later command are deleted when
+ * that command gets dropped too, or together with the remaining history.
+ */
+void PaintArea::adoptItems(const QList<AbstractPainterItem*>& items)
+{
+    for (auto item : items) {
+        mOrphanedItems.insert(item);
+    }
+}
+
+void PaintArea::deleteOrphanedItem(AbstractPainterItem* item)
+{
+    if (mOrphanedItems.remove(item)) {
+        delete item;
+    }
+}
+
+/*
+ * Called by painter items before they change, so the export buffer knows which
+ * regions need to be composited again on next export and the item index can
+ * put the item into its new place.
+ */
+void PaintArea::itemChanged(AbstractPainterItem* item)
+{
+    mExportBuffer->markItemDirty(item);
+    mItemIndex->markItemDirty(item);
+    if (mShadowLayer) {
+        mShadowLayer->markItemDirty(item);
+    }
+}
+
+void PaintArea::itemRemoved(AbstractPainterItem* item)
+{
+    mExportBuffer->releaseItem(item);
+    mItemIndex->removeItem(item);
+    if (mShadowLayer) {
+        mShadowLayer->removeItem(item);
+    }
+
+    auto dragIndex = mDragItems.indexOf(item);
+    if (dragIndex != -1) {
+        mDragItems.removeAt(dragIndex);
+        mDragStartPositions.removeAt(dragIndex);
+    }
+}
+
 void PaintArea::mousePressEvent(QGraphicsSceneMouseEvent* event)
 {
     if (!mIsEnabled) {
@@ -192,11 +323,7 @@ void PaintArea::mousePressEvent(QGraphicsSceneMouseEvent* event)
         } else if (mPaintMode == Painter::Move) {
             mCurrentItem = selectItemAt(event->scenePos());
             setCursor();
-            for (auto item : selectedItems()) {
-                if (item) {
-                    item->setOffset(event->scenePos() - item->position());
-                }
-            }
+            beginItemDrag(event->scenePos());
         } else if (mPaintMode == Painter::Select) {
             if (views().isEmpty()) {
                 return;
@@ -212,7 +339,7 @@ void PaintArea::mousePressEvent(QGraphicsSceneMouseEvent* event)
         } else {
             clearSelection();
             mCurrentItem = mPainterItemFactory->createItem(mPaintMode, event->scenePos());
-            mUndoStack->push(new AddCommand(mCurrentItem, this));
+            pushCommand(new AddCommand(mCurrentItem, this));
             auto textItem = dynamic_cast<PainterText*>(mCurrentItem);
             if(textItem) {
                 textItem->setFocus();
@@ -246,9 +373,8 @@ void PaintArea::mouseReleaseEvent(QGraphicsSceneMouseEvent* event)
         case Painter::Pen:
         case Painter::Marker:
             PainterPen* path;
-            if (mConfig->smoothPathEnabled() &&
-                    (path = qgraphicsitem_cast<PainterPen*>(mCurrentItem))) {
-                path->smoothOut(mConfig->smoothFactor());
+            if ((path = qgraphicsitem_cast<PainterPen*>(mCurrentItem))) {
+                path->finish();
             }
         case Painter::Rect:
         case Painter::Ellipse:
@@ -256,6 +382,7 @@ void PaintArea::mouseReleaseEvent(QGraphicsSceneMouseEvent* event)
         case Painter::Arrow:
         case Painter::Text:
         case Painter::Number:
+        case Painter::Redact:
             // We enable select first after the item was successfully added to
             // the scene, to prevent selection border around it while drawing.
             if (mCurrentItem) {
@@ -265,11 +392,7 @@ void PaintArea::mouseReleaseEvent(QGraphicsSceneMouseEvent* event)
         case Painter::Erase:
             break;
         case Painter::Move:
-            for (auto item : selectedItems()) {
-                if (item) {
-                    item->setOffset(QPointF());
-                }
-            }
+            endItemDrag();
             mCurrentItem = nullptr;
             setCursor();
             break;
@@ -375,12 +498,15 @@ void PaintArea::eraseItemAt(const QPointF& position, int size)
     }
 }
 
+/*
+ * Only items whose bounding rect is near the position are checked, the item
+ * index delivers them already in stacking order.
+ */
 AbstractPainterItem* PaintArea::findItemAt(const QPointF& position, int size)
 {
-    for (auto item : items()) {
-        auto baseItem = qgraphicsitem_cast<AbstractPainterItem*> (item);
-
-        if (baseItem && baseItem->containsRect(position, QSize(size, size))) {
+    auto rect = QRectF(position - QPointF(size / 2, size / 2), QSizeF(size, size));
+    for (auto baseItem : mItemIndex->items(rect)) {
+        if (baseItem->containsRect(position, QSize(size, size))) {
             baseItem->setOffset(position - baseItem->boundingRect().topLeft());
             return baseItem;
         }
@@ -391,14 +517,44 @@ AbstractPainterItem* PaintArea::findItemAt(const QPointF& position, int size)
 }
 
 /*
- * Moves all selected items to new provided position. Items own offset is taken
- * into account.
+ * Starts a drag of the selected items. The selection and the start positions
+ * are captured once here, the drag itself only translates the captured items
+ * and the undo command is created when the drag ends.
+ */
+void PaintArea::beginItemDrag(const QPointF& position)
+{
+    mDragItems = selectedItems();
+    mDragStartPositions.clear();
+    for (auto item : mDragItems) {
+        item->setOffset(QPointF());
+        mDragStartPositions.append(item->position());
+    }
+    mDragOrigin = position;
+}
+
+/*
+ * Moves the dragged items by the distance between the provided position and
+ * the position where the drag started.
  */
 void PaintArea::moveItems(const QPointF& position)
 {
-    if (!selectedItems().isEmpty()) {
-        mUndoStack->push(new MoveCommand(this, position));
+    auto distance = position - mDragOrigin;
+    for (auto i = 0; i < mDragItems.count(); i++) {
+        mDragItems[i]->moveTo(mDragStartPositions[i] + distance);
+    }
+}
+
+/*
+ * Ends the drag and records it as a single move on the undo stack, a drag that
+ * didn't move anything leaves the stack untouched.
+ */
+void PaintArea::endItemDrag()
+{
+    if (!mDragItems.isEmpty() && mDragItems.first()->position() != mDragStartPositions.first()) {
+        pushCommand(new MoveCommand(this, mDragItems, mDragStartPositions));
     }
+    mDragItems.clear();
+    mDragStartPositions.clear();
 }
 
 void PaintArea::clearCurrentItem()
@@ -408,12 +564,89 @@ void PaintArea::clearCurrentItem()
     }
     if (!mCurrentItem->isValid()) {
         mUndoStack->undo();
-        mUndoStack->push(new QUndoCommand(""));
+        pushCommand(new QUndoCommand(""));
         mUndoStack->undo();
     }
     mCurrentItem = nullptr;
 }
 
+/*
+ * Deletes adopted items that are not on the scene, only called after the undo
+ * history was cleared, so nothing refers to them anymore.
+ */
+void PaintArea::deleteOrphanedItems()
+{
+    for (auto item : mOrphanedItems) {
+        if (!item->scene()) {
+            delete item;
+        }
+    }
+    mOrphanedItems.clear();
+}
+
+/*
+ * Pushes the command to the undo stack and keeps our own list of the commands
+ * on the stack in sync, the stack only provides access to its commands since
+ * Qt 5.9. Pushing removes all undone commands, same as the stack does.
+ */
+void PaintArea::pushCommand(QUndoCommand* command)
+{
+    while (mCommands.count() > mUndoStack->index()) {
+        mCommands.removeLast();
+    }
+    mUndoStack->push(command);
+    mCommands.append(command);
+
+    trimUndoHistory();
+}
+
+/*
+ * Keeps the memory held by the undo history within the configured limit. First
+ * caches of items only held by the history are released, starting with the
+ * oldest commands, then the data of those items is spilled to a temporary
+ * file. Only if that is not enough either, the oldest commands are dropped and
+ * the undo floor is raised above them. The latest command is always kept.
+ */
+void PaintArea::trimUndoHistory()
+{
+    auto limit = qint64(mConfig->undoMemoryLimit()) * 1024 * 1024;
+    auto usage = undoMemoryUsage();
+    if (usage <= limit) {
+        return;
+    }
+
+    for (auto i = mUndoFloor; i < mCommands.count() && usage > limit; i++) {
+        auto command = dynamic_cast<AbstractUndoCommand*>(mCommands[i]);
+        if (command) {
+            usage -= command->byteCount();
+            command->compress();
+            usage += command->byteCount();
+        }
+    }
+
+    auto device = usage > limit ? spillFile() : nullptr;
+    for (auto i = mUndoFloor; device && i < mCommands.count() && usage > limit; i++) {
+        auto command = dynamic_cast<AbstractUndoCommand*>(mCommands[i]);
+        if (command) {
+            usage -= command->byteCount();
+            command->spill(device);
+            usage += command->byteCount();
+        }
+    }
+
+    while (usage > limit && mUndoFloor < mUndoStack->index() - 1) {
+        auto command = dynamic_cast<AbstractUndoCommand*>(mCommands[mUndoFloor]);
+        if (command) {
+            usage -= command->byteCount();
+            command->drop();
+            usage += command->byteCount();
+        }
+        mUndoFloor++;
+    }
+
+    updateUndoAction();
+}
+
 /*
  * Returns a new custom cursor based on currently selected paint tool, if the
  * scene is disabled return to default cursor.
@@ -471,7 +704,7 @@ AbstractPainterItem* PaintArea::selectItemAt(const QPointF& point, int size)
         return nullptr;
     }
 
-    if (!selectedItems().contains(item)) {
+    if (!item->isSelected()) {
         clearSelection();
     }
     item->setSelected(true);
@@ -479,14 +712,23 @@ AbstractPainterItem* PaintArea::selectItemAt(const QPointF& point, int size)
 }
 
 /*
- * The QGraphicsScene setSelectionArea only accepts paths so we use this
- * function as a workaround and turn the rect into a path.
+ * Selects all items whose shape lies completely inside the rect, same as the
+ * QGraphicsScene setSelectionArea with Qt::ContainsItemShape, but only looks
+ * at items the item index reports near the rect. The shape is only checked
+ * when the bounding rect is not already inside the rect.
  */
 void PaintArea::setSelectionArea(const QRectF& rect)
 {
     QPainterPath path;
     path.addRect(rect);
-    QGraphicsScene::setSelectionArea(path, Qt::ContainsItemShape);
+
+    clearSelection();
+    for (auto item : mItemIndex->items(rect)) {
+        if (rect.contains(item->sceneBoundingRect())
+                || path.contains(item->mapToScene(item->shape()))) {
+            item->setSelected(true);
+        }
+    }
 }
 
 /*
@@ -515,7 +757,7 @@ void PaintArea::bringForward(bool toFront)
     }
     // Check if we have any swapping, if yes, create a new undo/redo command
     if (!list->isEmpty()) {
-        mUndoStack->push(new ReOrderCommand(list));
+        pushCommand(new ReOrderCommand(list));
     }
 }
 
@@ -542,7 +784,7 @@ void PaintArea::sendBackward(bool toBack)
     }
     // Check if we have any swapping, if yes, create a new undo/redo command
     if (!list->isEmpty()) {
-        mUndoStack->push(new ReOrderCommand(list));
+        pushCommand(new ReOrderCommand(list));
     }
 }
 
@@ -563,12 +805,25 @@ void PaintArea::copySelectedItems(const QPointF& pos)
 void PaintArea::pastCopiedItems(const QPointF& pos)
 {
     if (mCopiedItems.count() > 0) {
-        mUndoStack->push(new PastCommand(this, pos));
+        pushCommand(new PastCommand(this, pos));
     }
 }
 
 void PaintArea::eraseSelectedItems()
 {
-    mUndoStack->push(new DeleteCommand(this));
+    pushCommand(new DeleteCommand(this));
 }
 
+void PaintArea::undo()
+{
+    if (mUndoStack->index() > mUndoFloor) {
+        mUndoStack->undo();
+    }
+}
+
+void PaintArea::updateUndoAction()
+{
+    if (mUndoAction) {
+        mUndoAction->setEnabled(mIsEnabled && mUndoStack->index() > mUndoFloor);
+    }
+}
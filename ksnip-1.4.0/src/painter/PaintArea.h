@@ -26,7 +26,10 @@
 #include <QGraphicsSceneMouseEvent>
 #include <QAction>
 #include <QRubberBand>
+#include <QSet>
+#include <QTemporaryFile>
 
+#include "AbstractPaintArea.h"
 #include "PainterItemFactory.h"
 #include "PainterPen.h"
 #include "PainterRect.h"
@@ -35,11 +38,14 @@
 #include "PainterText.h"
 #include "PainterNumber.h"
 #include "PaintModes.h"
+#include "ExportBuffer.h"
+#include "PainterItemIndex.h"
+#include "ShadowLayer.h"
 #include "src/widgets/UndoCommands.h"
 #include "src/widgets/CursorFactory.h"
 #include "src/widgets/ContextMenu.h"
 
-class PaintArea : public QGraphicsScene
+class PaintArea : public AbstractPaintArea
 {
     Q_OBJECT
 public:
@@ -51,9 +57,10 @@ public:
     void setPaintMode(Painter::Modes paintMode);
     Painter::Modes paintMode() const;
     QImage exportAsImage();
+    virtual const QImage &capture() override;
     void setIsEnabled(bool enabled);
     bool isEnabled() const;
-    bool isValid() const;
+    virtual bool isValid() const override;
     bool isTextEditing() const;
     void crop(const QRectF &rect);
     QPointF cropOffset() const;
@@ -61,6 +68,12 @@ public:
     QAction *getRedoAction();
     QList<AbstractPainterItem *> selectedItems(Qt::SortOrder order = Qt::DescendingOrder) const;
     QList<AbstractPainterItem *> copiedItems() const;
+    qint64 undoMemoryUsage() const;
+    QIODevice *spillFile();
+    void adoptItems(const QList<AbstractPainterItem *> &items);
+    void deleteOrphanedItem(AbstractPainterItem *item);
+    virtual void itemChanged(AbstractPainterItem *item) override;
+    virtual void itemRemoved(AbstractPainterItem *item) override;
 
 signals:
     void imageChanged();
@@ -76,6 +89,8 @@ protected:
 private:
     bool                 mIsEnabled;
     QGraphicsPixmapItem *mScreenshot;
+    QImage               mCapture;
+    ShadowLayer         *mShadowLayer;
     AbstractPainterItem *mCurrentItem;
     QRubberBand         *mRubberBand;
     QPoint               mRubberBandOrigin;
@@ -84,17 +99,31 @@ private:
     bool                 mCtrlPressed;
     Painter::Modes       mPaintMode;
     QUndoStack          *mUndoStack;
+    QList<QUndoCommand *> mCommands;
+    int                  mUndoFloor;
+    QTemporaryFile      *mSpillFile;
     QAction             *mUndoAction;
     QAction             *mRedoAction;
     KsnipConfig         *mConfig;
     PainterItemFactory  *mPainterItemFactory;
     CursorFactory       *mCursorFactory;
+    ExportBuffer        *mExportBuffer;
+    PainterItemIndex    *mItemIndex;
     QList<AbstractPainterItem *> mCopiedItems;
+    QSet<AbstractPainterItem *>  mOrphanedItems;
+    QList<AbstractPainterItem *> mDragItems;
+    QList<QPointF>               mDragStartPositions;
+    QPointF                      mDragOrigin;
 
     void eraseItemAt(const QPointF &position, int size = 10);
     AbstractPainterItem *findItemAt(const QPointF &position, int size = 10);
+    void beginItemDrag(const QPointF &position);
     void moveItems(const QPointF &position);
+    void endItemDrag();
     void clearCurrentItem();
+    void pushCommand(QUndoCommand *command);
+    void trimUndoHistory();
+    void deleteOrphanedItems();
     QCursor *cursor();
     QPoint mapToView(const QPointF &point) const;
     QRectF mapFromView(const QRectF &rect) const;
@@ -104,6 +133,8 @@ private:
 
 private slots:
     void setCursor();
+    void undo();
+    void updateUndoAction();
     void bringForward(bool toFront = false);
     void sendBackward(bool toBack = false);
     void copySelectedItems(const QPointF& pos);
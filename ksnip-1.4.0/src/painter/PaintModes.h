@@ -34,7 +34,8 @@ namespace Painter
         Number,
         Erase,
         Move,
-        Select
+        Select,
+        Redact
     };
 }
 
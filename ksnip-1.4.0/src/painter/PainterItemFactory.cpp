@@ -28,7 +28,10 @@ AbstractPainterItem* PainterItemFactory::createItem(Painter::Modes mode, const Q
 {
     auto item = createNewItem(mode, pos);
 
-    if (item && mode != Painter::Marker && mConfig->itemShadowEnabled()) {
+    if (item
+            && mode != Painter::Marker
+            && mode != Painter::Redact
+            && mConfig->itemShadowEnabled()) {
         item->addShadowEffect();
     }
 
@@ -47,6 +50,8 @@ AbstractPainterItem * PainterItemFactory::createCopyOfItem(AbstractPainterItem*
         return new PainterLine(*item);
     } else if (auto item = dynamic_cast<PainterEllipse*>(other)) {
         return new PainterEllipse(*item);
+    } else if (auto item = dynamic_cast<PainterRedact*>(other)) {
+        return new PainterRedact(*item);
     } else if (auto item = dynamic_cast<PainterRect*>(other)) {
         return new PainterRect(*item);
     } else if (auto item = dynamic_cast<PainterNumber*>(other)) {
@@ -62,9 +67,9 @@ AbstractPainterItem* PainterItemFactory::createNewItem(Painter::Modes mode, cons
 {
     switch (mode) {
     case Painter::Pen:
-        return new PainterPen(pos, mConfig->pen());
+        return new PainterPen(pos, mConfig->pen(), mConfig->pathTolerance(), smoothFactor());
     case Painter::Marker:
-        return new PainterMarker(pos, mConfig->marker());
+        return new PainterMarker(pos, mConfig->marker(), mConfig->pathTolerance(), smoothFactor());
     case Painter::Rect:
         return new PainterRect(pos, mConfig->rect(), mConfig->rectFill());
     case Painter::Ellipse:
@@ -77,8 +82,15 @@ AbstractPainterItem* PainterItemFactory::createNewItem(Painter::Modes mode, cons
         return new PainterText(pos - QPointF(0, 12), mConfig->text(), mConfig->textFont());
     case Painter::Number:
         return new PainterNumber(pos, mConfig->number(), mConfig->numberFont());
+    case Painter::Redact:
+        return new PainterRedact(pos, mConfig->redact(), mConfig->redactBlur());
     default:
         return nullptr;
     }
 }
 
+int PainterItemFactory::smoothFactor() const
+{
+    return mConfig->smoothPathEnabled() ? mConfig->smoothFactor() : 0;
+}
+
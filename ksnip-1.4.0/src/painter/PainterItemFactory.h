@@ -23,6 +23,7 @@
 #include "PainterPen.h"
 #include "PainterMarker.h"
 #include "PainterRect.h"
+#include "PainterRedact.h"
 #include "PainterEllipse.h"
 #include "PainterLine.h"
 #include "PainterArrow.h"
@@ -42,6 +43,7 @@ private:
     KsnipConfig *mConfig;
 
     AbstractPainterItem *createNewItem(Painter::Modes mode, const QPointF &pos) const;
+    int smoothFactor() const;
 };
 
 #endif // PAINTERITEMFACTORY_H
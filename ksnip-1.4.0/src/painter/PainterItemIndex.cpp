@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "PainterItemIndex.h"
+
+PainterItemIndex::PainterItemIndex()
+{
+}
+
+/*
+ * Items report changes before they happen, so the new bounds are not known
+ * yet. The item is only flagged here and put into the right cells on the next
+ * query.
+ */
+void PainterItemIndex::markItemDirty(AbstractPainterItem* item)
+{
+    mDirtyItems.insert(item);
+}
+
+void PainterItemIndex::removeItem(AbstractPainterItem* item)
+{
+    mDirtyItems.remove(item);
+    takeItem(item);
+}
+
+void PainterItemIndex::clear()
+{
+    mCells.clear();
+    mItemCells.clear();
+    mLargeItems.clear();
+    mDirtyItems.clear();
+}
+
+/*
+ * Returns all items whose bounding rect intersects the rect, top most first.
+ * Only the grid cells covered by the rect are visited, items that span too
+ * many cells to be worth bucketing are checked directly.
+ */
+QList<AbstractPainterItem*> PainterItemIndex::items(const QRectF& rect)
+{
+    update();
+
+    QSet<AbstractPainterItem*> candidates;
+    auto range = cellRange(rect);
+    for (auto x = range.left(); x <= range.right(); x++) {
+        for (auto y = range.top(); y <= range.bottom(); y++) {
+            auto cell = mCells.constFind(cellKey(x, y));
+            if (cell == mCells.constEnd()) {
+                continue;
+            }
+            for (auto item : *cell) {
+                candidates.insert(item);
+            }
+        }
+    }
+    for (auto item : mLargeItems) {
+        candidates.insert(item);
+    }
+
+    QList<AbstractPainterItem*> list;
+    for (auto item : candidates) {
+        if (item->sceneBoundingRect().intersects(rect)) {
+            list.append(item);
+        }
+    }
+
+    std::sort(list.begin(), list.end(), [](AbstractPainterItem * a, AbstractPainterItem * b) {
+        return a->zValue() > b->zValue();
+    });
+    return list;
+}
+
+/*
+ * Every item is counted once, items that were moved after being indexed are
+ * both in the cells and dirty.
+ */
+int PainterItemIndex::count() const
+{
+    auto count = mItemCells.count();
+    for (auto item : mDirtyItems) {
+        if (!mItemCells.contains(item)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+//
+// Private Functions
+//
+
+void PainterItemIndex::update()
+{
+    for (auto item : mDirtyItems) {
+        takeItem(item);
+        insertItem(item);
+    }
+    mDirtyItems.clear();
+}
+
+void PainterItemIndex::insertItem(AbstractPainterItem* item)
+{
+    auto range = cellRange(item->sceneBoundingRect());
+    mItemCells.insert(item, range);
+
+    if (range.width() * range.height() > mMaxCellsPerItem) {
+        mLargeItems.insert(item);
+        return;
+    }
+
+    for (auto x = range.left(); x <= range.right(); x++) {
+        for (auto y = range.top(); y <= range.bottom(); y++) {
+            mCells[cellKey(x, y)].append(item);
+        }
+    }
+}
+
+void PainterItemIndex::takeItem(AbstractPainterItem* item)
+{
+    auto iterator = mItemCells.find(item);
+    if (iterator == mItemCells.end()) {
+        return;
+    }
+
+    auto range = iterator.value();
+    mItemCells.erase(iterator);
+
+    if (mLargeItems.remove(item)) {
+        return;
+    }
+
+    for (auto x = range.left(); x <= range.right(); x++) {
+        for (auto y = range.top(); y <= range.bottom(); y++) {
+            auto cell = mCells.find(cellKey(x, y));
+            if (cell == mCells.end()) {
+                continue;
+            }
+            cell->removeOne(item);
+            if (cell->isEmpty()) {
+                mCells.erase(cell);
+            }
+        }
+    }
+}
+
+QRect PainterItemIndex::cellRange(const QRectF& rect) const
+{
+    return QRect(QPoint(qFloor(rect.left() / mCellSize), qFloor(rect.top() / mCellSize)),
+                 QPoint(qFloor(rect.right() / mCellSize), qFloor(rect.bottom() / mCellSize)));
+}
+
+quint64 PainterItemIndex::cellKey(int x, int y)
+{
+    return (quint64(quint32(x)) << 32) | quint32(y);
+}
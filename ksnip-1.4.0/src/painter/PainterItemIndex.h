@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef PAINTERITEMINDEX_H
+#define PAINTERITEMINDEX_H
+
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QtMath>
+#include <algorithm>
+
+#include "AbstractPainterItem.h"
+
+class PainterItemIndex
+{
+public:
+    PainterItemIndex();
+    void markItemDirty(AbstractPainterItem *item);
+    void removeItem(AbstractPainterItem *item);
+    void clear();
+    QList<AbstractPainterItem *> items(const QRectF &rect);
+    int count() const;
+
+private:
+    QHash<quint64, QVector<AbstractPainterItem *>> mCells;
+    QHash<AbstractPainterItem *, QRect>            mItemCells;
+    QSet<AbstractPainterItem *>                    mLargeItems;
+    QSet<AbstractPainterItem *>                    mDirtyItems;
+    const int                                      mCellSize = 64;
+    const int                                      mMaxCellsPerItem = 256;
+
+    void update();
+    void insertItem(AbstractPainterItem *item);
+    void takeItem(AbstractPainterItem *item);
+    QRect cellRange(const QRectF &rect) const;
+    static quint64 cellKey(int x, int y);
+};
+
+#endif // PAINTERITEMINDEX_H
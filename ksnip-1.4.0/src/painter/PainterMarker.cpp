@@ -19,7 +19,8 @@
 
 #include "PainterMarker.h"
 
-PainterMarker::PainterMarker(const QPointF& pos, const QPen& attributes) : PainterPen(pos, attributes)
+PainterMarker::PainterMarker(const QPointF& pos, const QPen& attributes, qreal tolerance, int smoothFactor) :
+    PainterPen(pos, attributes, tolerance, smoothFactor)
 {
 }
 
@@ -27,12 +28,161 @@ PainterMarker::PainterMarker(const PainterMarker& other) : PainterPen(other)
 {
 }
 
+/*
+ * The mask is only moved along when the stroke moves by whole pixels, any
+ * other move changes how the outline falls onto the pixels and the mask is
+ * rendered again on the next paint. Rounding would let the mask drift away
+ * from the stroke over several moves.
+ */
+void PainterMarker::moveTo(const QPointF& newPos)
+{
+    auto distance = newPos - offset() - boundingRect().topLeft();
+    PainterPen::moveTo(newPos);
+
+    auto pixels = distance.toPoint();
+    if (qFuzzyCompare(distance.x() + 1, pixels.x() + 1) && qFuzzyCompare(distance.y() + 1, pixels.y() + 1)) {
+        mMaskRect.translate(pixels);
+    } else {
+        mMask = QImage();
+    }
+}
+
+qint64 PainterMarker::byteCount() const
+{
+    return PainterPen::byteCount() + mMask.byteCount();
+}
+
+void PainterMarker::releaseCaches()
+{
+    PainterPen::releaseCaches();
+    if (!scene()) {
+        mMask = QImage();
+    }
+}
+
+//
+// Protected Functions
+//
+
+void PainterMarker::updateStroke()
+{
+    PainterPen::updateStroke();
+    mMask = QImage();
+}
+
+/*
+ * While drawing only the new piece is added to the mask, so the cost of a
+ * new point doesn't grow with the length of the stroke.
+ */
+QPainterPath PainterMarker::extendStroke(const QPainterPath& piece)
+{
+    auto segmentStroke = PainterPen::extendStroke(piece);
+    if (!mMask.isNull()) {
+        growMask(mStrokeBounds.toAlignedRect());
+        addToMask(segmentStroke);
+    }
+    return segmentStroke;
+}
+
+//
+// Private Functions
+//
+
+/*
+ * The stroke is rasterized once into a mask holding the marker color weighted
+ * by coverage, repaints only color burn the mask instead of filling the whole
+ * outline again. Burning a premultiplied pixel with alpha a is the same as
+ * burning the full color and keeping a of the result, which is what filling
+ * an anti-aliased outline does. Fully covered pixels match exactly, on the
+ * edges the color stored premultiplied loses precision, which is at most 3
+ * levels per channel for channels of 64 and above and grows for very dark
+ * channels. Channels of 0 and 255 always match.
+ */
 void PainterMarker::paint(QPainter* painter, const QStyleOptionGraphicsItem*, QWidget*)
 {
+    if (mMask.isNull() || mMaskColor != attributes().color()) {
+        renderMask();
+    }
+
+    // The mask may have grown beyond the stroke, only the part within the
+    // bounds is blended.
+    auto rect = mMaskRect & mStrokeBounds.toAlignedRect();
     painter->setCompositionMode(QPainter::CompositionMode_ColorBurn);
-    painter->setPen(Qt::NoPen);
-    painter->setBrush(attributes().color());
-    painter->drawPath(mStroker->createStroke(*mPath));
+    painter->drawImage(rect.topLeft(), mMask, rect.translated(-mMaskRect.topLeft()));
+
+    // The tail still changes with every new point and is not part of the mask.
+    if (!mTailStroke.isEmpty()) {
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(attributes().color());
+        painter->drawPath(mTailStroke);
+    }
+    painter->setCompositionMode(QPainter::CompositionMode_SourceOver);
 
     paintDecoration(painter);
 }
+
+void PainterMarker::renderMask()
+{
+    mMaskColor = attributes().color();
+    mMaskRect = mStrokeBounds.toAlignedRect();
+    mMask = QImage(mMaskRect.size(), QImage::Format_ARGB32_Premultiplied);
+    mMask.fill(Qt::transparent);
+
+    QPainter painter(&mMask);
+    fillPath(&painter, stroke(), mMaskRect.topLeft());
+}
+
+/*
+ * Makes room for a rect that is not yet covered by the mask. The mask grows by
+ * more than required, so a stroke extending in one direction doesn't copy the
+ * mask on every new point.
+ */
+void PainterMarker::growMask(const QRect& rect)
+{
+    if (mMaskRect.contains(rect)) {
+        return;
+    }
+
+    auto grownRect = mMaskRect.united(rect.adjusted(-mMaskGrowth, -mMaskGrowth, mMaskGrowth, mMaskGrowth));
+    QImage grownMask(grownRect.size(), QImage::Format_ARGB32_Premultiplied);
+    grownMask.fill(Qt::transparent);
+
+    QPainter painter(&grownMask);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.drawImage(mMaskRect.topLeft() - grownRect.topLeft(), mMask);
+    painter.end();
+
+    mMask = grownMask;
+    mMaskRect = grownRect;
+}
+
+/*
+ * Where segments overlap the larger coverage is kept, same as the winding fill
+ * of the whole stroke does. Blending them over each other would darken the
+ * anti-aliased edges at every joint.
+ */
+void PainterMarker::addToMask(const QPainterPath& segmentStroke)
+{
+    auto rect = segmentStroke.boundingRect().toAlignedRect() & mMaskRect;
+    if (rect.isEmpty()) {
+        return;
+    }
+
+    QImage segment(rect.size(), QImage::Format_ARGB32_Premultiplied);
+    segment.fill(Qt::transparent);
+
+    QPainter painter(&segment);
+    fillPath(&painter, segmentStroke, rect.topLeft());
+    painter.end();
+
+    ImageFilterHelper::combineMaximum(mMask, segment, rect.topLeft() - mMaskRect.topLeft());
+}
+
+void PainterMarker::fillPath(QPainter* painter, const QPainterPath& path, const QPoint& origin) const
+{
+    painter->setRenderHint(QPainter::Antialiasing);
+    painter->translate(-origin);
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(mMaskColor);
+    painter->drawPath(path);
+}
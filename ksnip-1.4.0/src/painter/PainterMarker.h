@@ -21,15 +21,32 @@
 #define PAINTERMARKER_H
 
 #include "PainterPen.h"
+#include "src/helper/ImageFilterHelper.h"
 
 class PainterMarker : public PainterPen
 {
 public:
-    PainterMarker(const QPointF &pos, const QPen &attributes);
+    PainterMarker(const QPointF &pos, const QPen &attributes, qreal tolerance = 0, int smoothFactor = 0);
     PainterMarker(const PainterMarker& other);
+    virtual void moveTo(const QPointF &newPos) override;
+    virtual qint64 byteCount() const override;
+    virtual void releaseCaches() override;
+
+protected:
+    virtual void updateStroke() override;
+    virtual QPainterPath extendStroke(const QPainterPath &piece) override;
 
 private:
+    QImage mMask;
+    QRect  mMaskRect;
+    QColor mMaskColor;
+    const int mMaskGrowth = 64;
+
     virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *) override;
+    void renderMask();
+    void growMask(const QRect &rect);
+    void addToMask(const QPainterPath &segmentStroke);
+    void fillPath(QPainter *painter, const QPainterPath &path, const QPoint &origin) const;
 };
 
 #endif // PAINTERMARKER_H
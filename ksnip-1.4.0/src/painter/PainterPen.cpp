@@ -24,19 +24,31 @@
 
 #include "PainterPen.h"
 
-PainterPen::PainterPen(const QPointF& pos, const QPen& attributes) :
+Q_LOGGING_CATEGORY(ksnipPainter, "ksnip.painter", QtWarningMsg)
+
+PainterPen::PainterPen(const QPointF& pos, const QPen& attributes, qreal tolerance, int smoothFactor) :
     AbstractPainterItem(attributes),
     mPath(new QPainterPath),
-    mStroker(new QPainterPathStroker(this->attributes()))
+    mStroker(new QPainterPathStroker(this->attributes())),
+    mTolerance(tolerance),
+    mSmoothFactor(smoothFactor),
+    mHasCorner(false),
+    mPointCount(1)
 {
-    // Place the path at the right location and draw the first point, which is
-    // actually a line just moved one pixel as QT won't draw a line if the point
-    // B is equal to point A
+    // The path starts with a line just moved one pixel, as QT won't draw a line
+    // if the point B is equal to point A. The line is the tail of the path and
+    // gets replaced by the first point added.
     mPath->moveTo(pos);
-    mPath->lineTo(pos + QPointF(1, 1));
+    mTailEnd = pos + QPointF(1, 1);
 
     mStroker->setCapStyle(Qt::RoundCap);
     mStroker->setJoinStyle(Qt::RoundJoin);
+
+    // Not calling the virtual updateStroke(), subclasses are not constructed
+    // yet.
+    mStroke = mStroker->createStroke(*mPath);
+    mStrokeBounds = mStroke.boundingRect();
+    updateTail();
 }
 
 PainterPen::PainterPen(const PainterPen& other) : AbstractPainterItem(other)
@@ -46,6 +58,18 @@ PainterPen::PainterPen(const PainterPen& other) : AbstractPainterItem(other)
     this->mStroker->setWidth(other.mStroker->width());
     this->mStroker->setCapStyle(other.mStroker->capStyle());
     this->mStroker->setJoinStyle(other.mStroker->joinStyle());
+    this->mStroke = other.mStroke;
+    this->mStrokeBounds = other.mStrokeBounds;
+    this->mTail = other.mTail;
+    this->mTailStroke = other.mTailStroke;
+    this->mTolerance = other.mTolerance;
+    this->mSmoothFactor = other.mSmoothFactor;
+    this->mTailEnd = other.mTailEnd;
+    this->mCorner = other.mCorner;
+    this->mCornerEntry = other.mCornerEntry;
+    this->mHasCorner = other.mHasCorner;
+    this->mMergedPoints = other.mMergedPoints;
+    this->mPointCount = other.mPointCount;
 }
 
 PainterPen::~PainterPen()
@@ -56,81 +80,269 @@ PainterPen::~PainterPen()
 
 QRectF PainterPen::boundingRect() const
 {
-    return mStroker->createStroke(*mPath).boundingRect();
+    return mStrokeBounds;
 }
 
+/*
+ * The path is built while drawing. The last part of it, the tail, still
+ * changes with new points and is kept separately, everything before it is
+ * final. A point becomes a corner of the path when it is far enough from the
+ * previous corner, see smooth factor, and when it can't be merged into the
+ * line to the new point. When smoothing, every corner is rounded by a quad
+ * curve once the corner after it is known, the tail runs through the corner
+ * not yet rounded to the newest point.
+ */
 void PainterPen::addPoint(const QPointF& pos, bool modifier)
 {
     prepareGeometryChange();
-    mPath->lineTo(pos);
+    mPointCount++;
+
+    if (isCorner(mTailEnd)) {
+        if (canMergeTailEnd(pos)) {
+            mMergedPoints.append(mTailEnd);
+        } else {
+            commitCorner(mTailEnd);
+        }
+    }
+
+    mTailEnd = pos;
+    updateTail();
 }
 
 void PainterPen::moveTo(const QPointF& newPos)
 {
     prepareGeometryChange();
-    mPath->translate(newPos - offset() - boundingRect().topLeft());
+    auto distance = newPos - offset() - boundingRect().topLeft();
+    mPath->translate(distance);
+    mStroke.translate(distance);
+    mTail.translate(distance);
+    mTailStroke.translate(distance);
+    mStrokeBounds.translate(distance);
 }
 
 bool PainterPen::containsRect(const QPointF& topLeft, const QSize& size) const
 {
-    return mPath->intersects(QRectF(topLeft.x() - size.width() / 2,
-                                    topLeft.y() - size.height() / 2,
-                                    size.width(),
-                                    size.height()));
+    QRectF rect(topLeft.x() - size.width() / 2,
+                topLeft.y() - size.height() / 2,
+                size.width(),
+                size.height());
+    return mPath->intersects(rect) || mTail.intersects(rect);
 }
 
 /*
- * Simple function that smooths out the existing path. The function basically
- * collects all points in a path and skips points that are too close to each
- * other, to close points prevent smoothing out. Then in next step on every
- * point we remove the corner between two lines and replace it with an quadTo
- * Bezier curve. The min factor is used to test the distance between two points,
- * distance below min is ignored and points skipped.
+ * Called when drawing the path has ended, the newest point becomes the last
+ * corner and the tail is added to the path. Only the tail is stroked, so
+ * finishing costs the same no matter how long the path is.
  */
-void PainterPen::smoothOut(float factor)
+void PainterPen::finish()
 {
-    QList<QPointF> points;
-    QPointF p;
-    for (auto i = 0; i < mPath->elementCount() - 1; i++) {
-        p = QPointF(mPath->elementAt(i).x, mPath->elementAt(i).y);
+    prepareGeometryChange();
+    commitCorner(mTailEnd);
+    if (mHasCorner) {
+        QPainterPath piece(mPath->currentPosition());
+        piece.lineTo(mCorner);
+        extendStroke(piece);
+        mHasCorner = false;
+    }
+    mMergedPoints.clear();
+    mTail = QPainterPath();
+    mTailStroke = QPainterPath();
 
-        // Except for first and last points, check what the distance between two
-        // points is and if its less the min, don't add them to the list.
-        if (points.count() > 1 && (i < mPath->elementCount() - 2) && (MathHelper::distanceBetweenPoints(points.last(), p) < factor)) {
-            continue;
-        }
-        points.append(p);
+    qCDebug(ksnipPainter, "Path kept %d elements of %d points, outline has %d elements",
+            mPath->elementCount(), mPointCount, mStroke.elementCount());
+}
+
+/*
+ * Number of points added while drawing, storedPointCount() is how many of them
+ * the path kept after merging.
+ */
+int PainterPen::pointCount() const
+{
+    return mPointCount;
+}
+
+int PainterPen::storedPointCount() const
+{
+    return mPath->elementCount();
+}
+
+qint64 PainterPen::byteCount() const
+{
+    auto elementCount = mPath->elementCount() + mStroke.elementCount();
+    return sizeof(PainterPen) + elementCount * sizeof(QPainterPath::Element);
+}
+
+/*
+ * The stroked outline is usually many times larger than the path itself and
+ * can be rebuilt from it, so it's dropped while the item is not on a scene.
+ * The bounds are kept, they don't change by rebuilding the outline.
+ */
+void PainterPen::releaseCaches()
+{
+    if (!scene()) {
+        mStroke = QPainterPath();
     }
+}
 
-    // Don't proceed if we only have 3 or less points.
-    if (points.count() < 3) {
-        return;
+//
+// Protected Functions
+//
+
+/*
+ * Returns the cached outline, rebuilds it if it was released.
+ */
+const QPainterPath& PainterPen::stroke()
+{
+    if (mStroke.isEmpty()) {
+        mStroke = mStroker->createStroke(*mPath);
     }
+    return mStroke;
+}
 
-    QPointF pt1;
-    QPointF pt2;
-    QPainterPath* path = new QPainterPath();
-    for (auto i = 0; i < points.count() - 1; i++) {
-        pt1 = MathHelper::getBeginOfRounding(points[i], points[i + 1]);
-        if (i == 0) {
-            path->moveTo(pt1);
-        } else {
-            path->quadTo(points[i], pt1);
-        }
-        pt2 = MathHelper::getEndOfRounding(points[i], points[i + 1]);
-        path->lineTo(pt2);
+/*
+ * Strokes the whole path and replaces the cached outline, only required when
+ * the path was replaced, for regular drawing extendStroke() is used.
+ */
+void PainterPen::updateStroke()
+{
+    mStroke = mStroker->createStroke(*mPath);
+    mStrokeBounds = mStroke.boundingRect();
+}
+
+/*
+ * Appends the piece to the path and strokes only the piece, so appending
+ * costs the same no matter how long the path already is. The stroke uses
+ * winding fill so the overlapping round caps of neighbouring pieces are
+ * filled only once. Returns the added outline.
+ */
+QPainterPath PainterPen::extendStroke(const QPainterPath& piece)
+{
+    mPath->connectPath(piece);
+    auto pieceStroke = mStroker->createStroke(piece);
+    mStroke.addPath(pieceStroke);
+    mStrokeBounds = mStrokeBounds.united(pieceStroke.boundingRect());
+    return pieceStroke;
+}
+
+/*
+ * Only the path is written, the outline is rebuilt from it when the item is
+ * painted again.
+ */
+bool PainterPen::writeSpill(QDataStream& stream)
+{
+    stream << *mPath;
+    if (stream.status() != QDataStream::Ok) {
+        return false;
     }
+    *mPath = QPainterPath();
+    mStroke = QPainterPath();
+    return true;
+}
 
-    delete mPath;
-    prepareGeometryChange();
-    mPath = path;
+void PainterPen::readSpill(QDataStream& stream)
+{
+    stream >> *mPath;
 }
 
+//
+// Private Functions
+//
+
 void PainterPen::paint(QPainter* painter, const QStyleOptionGraphicsItem*, QWidget*)
 {
     painter->setPen(attributes().color());
     painter->setBrush(attributes().color());
-    painter->drawPath(mStroker->createStroke(*mPath));
+    painter->drawPath(stroke());
+    painter->drawPath(mTailStroke);
 
     paintDecoration(painter);
 }
+
+/*
+ * The last corner of the path, or where the path ends when there is no corner
+ * waiting to be rounded.
+ */
+QPointF PainterPen::anchor() const
+{
+    return mHasCorner ? mCorner : mPath->currentPosition();
+}
+
+/*
+ * When smoothing, points closer to the previous corner than the smooth factor
+ * are skipped, rounding such short lines would only add noise.
+ */
+bool PainterPen::isCorner(const QPointF& point) const
+{
+    if (mSmoothFactor <= 0) {
+        return true;
+    }
+    auto distance = point - anchor();
+    return QPointF::dotProduct(distance, distance) >= mSmoothFactor * mSmoothFactor;
+}
+
+/*
+ * The end of the tail can be merged when it lies close enough to the line
+ * from the last corner to the new point. All points merged before are checked
+ * again against the new line, so no point drawn drifts further than the
+ * tolerance from the path.
+ */
+bool PainterPen::canMergeTailEnd(const QPointF& pos) const
+{
+    if (mTolerance <= 0 || mMergedPoints.count() >= mMaxMergedPoints) {
+        return false;
+    }
+
+    auto toleranceSquared = mTolerance * mTolerance;
+    auto lineStart = anchor();
+    if (MathHelper::squaredDistanceToLine(mTailEnd, lineStart, pos) > toleranceSquared) {
+        return false;
+    }
+    for (const auto &point : mMergedPoints) {
+        if (MathHelper::squaredDistanceToLine(point, lineStart, pos) > toleranceSquared) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Without smoothing the corner is added to the path right away. With smoothing
+ * the previous corner is rounded now that the line leaving it is known, and
+ * the new corner waits for the next one.
+ */
+void PainterPen::commitCorner(const QPointF& corner)
+{
+    mMergedPoints.clear();
+
+    if (mSmoothFactor <= 0) {
+        QPainterPath piece(mPath->currentPosition());
+        piece.lineTo(corner);
+        extendStroke(piece);
+        return;
+    }
+
+    if (mHasCorner) {
+        QPainterPath piece(mPath->currentPosition());
+        piece.lineTo(mCornerEntry);
+        piece.quadTo(mCorner, MathHelper::getBeginOfRounding(mCorner, corner));
+        extendStroke(piece);
+    }
+    mCornerEntry = MathHelper::getEndOfRounding(anchor(), corner);
+    mCorner = corner;
+    mHasCorner = true;
+}
+
+/*
+ * The tail is stroked as a whole on every new point, it never holds more than
+ * two lines.
+ */
+void PainterPen::updateTail()
+{
+    mTail = QPainterPath(mPath->currentPosition());
+    if (mHasCorner) {
+        mTail.lineTo(mCorner);
+    }
+    mTail.lineTo(mTailEnd);
+    mTailStroke = mStroker->createStroke(mTail);
+    mStrokeBounds = mStrokeBounds.united(mTailStroke.boundingRect());
+}
@@ -20,27 +20,60 @@
 #ifndef PAINTERPEN_H
 #define PAINTERPEN_H
 
+#include <QLoggingCategory>
+
 #include "AbstractPainterItem.h"
 #include "src/helper/MathHelper.h"
 
+Q_DECLARE_LOGGING_CATEGORY(ksnipPainter)
+
 class PainterPen : public AbstractPainterItem
 {
 public:
-    PainterPen(const QPointF &pos, const QPen &attributes);
+    PainterPen(const QPointF &pos, const QPen &attributes, qreal tolerance = 0, int smoothFactor = 0);
     PainterPen(const PainterPen& other);
     virtual ~PainterPen() override;
     virtual QRectF boundingRect() const override;
     virtual void addPoint(const QPointF &pos, bool modifier = 0) override;
     virtual void moveTo(const QPointF &newPos) override;
     virtual bool containsRect(const QPointF &topLeft, const QSize &size) const override;
-    void smoothOut(float factor);
+    void finish();
+    int pointCount() const;
+    int storedPointCount() const;
+    virtual qint64 byteCount() const override;
+    virtual void releaseCaches() override;
 
 protected:
     QPainterPath        *mPath;
     QPainterPathStroker *mStroker;
+    QPainterPath         mStroke;
+    QRectF               mStrokeBounds;
+    QPainterPath         mTail;
+    QPainterPath         mTailStroke;
+
+    const QPainterPath &stroke();
+    virtual void updateStroke();
+    virtual QPainterPath extendStroke(const QPainterPath &piece);
+    virtual bool writeSpill(QDataStream &stream) override;
+    virtual void readSpill(QDataStream &stream) override;
 
 private:
+    qreal                mTolerance;
+    int                  mSmoothFactor;
+    QPointF              mTailEnd;
+    QPointF              mCorner;
+    QPointF              mCornerEntry;
+    bool                 mHasCorner;
+    QList<QPointF>       mMergedPoints;
+    int                  mPointCount;
+    const int            mMaxMergedPoints = 32;
+
     virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *) override;
+    QPointF anchor() const;
+    bool isCorner(const QPointF &point) const;
+    bool canMergeTailEnd(const QPointF &pos) const;
+    void commitCorner(const QPointF &corner);
+    void updateTail();
 };
 
 #endif // PAINTERPEN_H
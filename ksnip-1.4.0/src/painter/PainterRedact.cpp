@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "PainterRedact.h"
+
+PainterRedact::PainterRedact(const QPointF& pos, const QPen& attributes, bool blur) :
+    PainterRect(pos, attributes, true),
+    mBlur(blur),
+    mCacheStrength(0)
+{
+}
+
+PainterRedact::PainterRedact(const PainterRedact& other) : PainterRect(other)
+{
+    this->mBlur = other.mBlur;
+    this->mCacheStrength = 0;
+}
+
+qint64 PainterRedact::byteCount() const
+{
+    return sizeof(PainterRedact) + mCache.byteCount();
+}
+
+/*
+ * The filtered pixels can be rebuilt from the capture at any time, so they
+ * are dropped while the item is not on a scene.
+ */
+void PainterRedact::releaseCaches()
+{
+    if (!scene()) {
+        mCache = QImage();
+        mCacheRect = QRect();
+    }
+}
+
+//
+// Private Functions
+//
+
+/*
+ * The filtered pixels are painted opaque over the capture, an exported image
+ * contains only the filtered pixels and the original can't be recovered.
+ */
+void PainterRedact::paint(QPainter* painter, const QStyleOptionGraphicsItem*, QWidget*)
+{
+    auto area = paintArea();
+    if (area && area->isValid()) {
+        const auto &capture = area->capture();
+        auto rect = mapRectToScene(mRect.normalized()).toAlignedRect() & capture.rect();
+        if (!rect.isEmpty()) {
+            updateCache(capture, rect);
+            painter->drawImage(mapFromScene(rect.topLeft()), mCache);
+        }
+    }
+
+    paintDecoration(painter);
+}
+
+/*
+ * The cache covers exactly the redacted part of the capture. When the rect was
+ * moved or resized the overlapping part is taken from the previous cache and
+ * only the newly covered parts are filtered.
+ */
+void PainterRedact::updateCache(const QImage& capture, const QRect& rect)
+{
+    auto strength = attributes().width();
+    if (mCacheStrength != strength) {
+        mCache = QImage();
+        mCacheStrength = strength;
+    }
+
+    if (!mCache.isNull() && mCacheRect == rect) {
+        return;
+    }
+
+    QImage cache(rect.size(), capture.format());
+    QPainter painter(&cache);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+
+    auto reused = mCache.isNull() ? QRect() : rect & mCacheRect;
+    if (!reused.isEmpty()) {
+        painter.drawImage(reused.topLeft() - rect.topLeft(),
+                          mCache,
+                          reused.translated(-mCacheRect.topLeft()));
+    }
+    for (auto part : QRegion(rect).subtracted(reused).rects()) {
+        painter.drawImage(part.topLeft() - rect.topLeft(), filter(capture, part));
+    }
+    painter.end();
+
+    mCache = cache;
+    mCacheRect = rect;
+}
+
+/*
+ * Filters one part of the capture, the result doesn't depend on how the
+ * redacted rect is split into parts. For blurring the capture is pixelated
+ * first, a plain blur can be partly reverted, and the margin makes sure all
+ * pixels that contribute to the blurred part are taken into account.
+ */
+QImage PainterRedact::filter(const QImage& capture, const QRect& rect) const
+{
+    auto strength = qMax(mCacheStrength, 2);
+    if (!mBlur) {
+        return ImageFilterHelper::pixelate(capture, rect, strength);
+    }
+
+    auto passes = 2;
+    auto margin = strength * passes;
+    auto source = rect.adjusted(-margin, -margin, margin, margin) & capture.rect();
+    auto image = ImageFilterHelper::pixelate(capture, source, strength / 2);
+    ImageFilterHelper::boxBlur(image, strength, passes);
+    return image.copy(rect.translated(-source.topLeft()));
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef PAINTERREDACT_H
+#define PAINTERREDACT_H
+
+#include "PainterRect.h"
+#include "src/helper/ImageFilterHelper.h"
+
+class PainterRedact : public PainterRect
+{
+public:
+    PainterRedact(const QPointF &pos, const QPen &attributes, bool blur = 0);
+    PainterRedact(const PainterRedact& other);
+    virtual qint64 byteCount() const override;
+    virtual void releaseCaches() override;
+
+private:
+    bool   mBlur;
+    QImage mCache;
+    QRect  mCacheRect;
+    int    mCacheStrength;
+
+    virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *) override;
+    void updateCache(const QImage &capture, const QRect &rect);
+    QImage filter(const QImage &capture, const QRect &rect) const;
+};
+
+#endif // PAINTERREDACT_H
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "ShadowLayer.h"
+
+/*
+ * Paints the drop shadows of all painter items in one pass, placed between the
+ * capture and the painter items. The blurred shadow of every item is cached
+ * until the item changes, so unchanged items cost one image blit per paint.
+ */
+ShadowLayer::ShadowLayer(const QRectF& rect) :
+    mRect(rect)
+{
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+QRectF ShadowLayer::boundingRect() const
+{
+    return mRect;
+}
+
+void ShadowLayer::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget*)
+{
+    auto margin = mBlurRadius * mBlurPasses + mOffset.manhattanLength();
+    auto exposedRect = option->exposedRect.adjusted(-margin, -margin, margin, margin);
+
+    for (auto baseItem : scene()->items(exposedRect, Qt::IntersectsItemBoundingRect, Qt::AscendingOrder)) {
+        auto item = qgraphicsitem_cast<AbstractPainterItem*>(baseItem);
+        if (item && item->hasShadow() && item->isVisible()) {
+            const auto &itemShadow = shadow(item);
+            if (itemShadow.rect.intersects(option->exposedRect.toAlignedRect())) {
+                painter->drawImage(itemShadow.rect.topLeft(), itemShadow.image);
+            }
+        }
+    }
+}
+
+/*
+ * Called before an item changes. The old shadow is repainted away right away,
+ * the new one is repainted once the change has happened.
+ */
+void ShadowLayer::markItemDirty(AbstractPainterItem* item)
+{
+    if (!item->hasShadow()) {
+        return;
+    }
+
+    if (mShadows.contains(item)) {
+        update(mShadows.take(item).rect);
+    }
+
+    if (mPendingItems.isEmpty()) {
+        QTimer::singleShot(0, this, [this]() {
+            updatePendingItems();
+        });
+    }
+    mPendingItems.insert(item);
+}
+
+void ShadowLayer::removeItem(AbstractPainterItem* item)
+{
+    if (mShadows.contains(item)) {
+        update(mShadows.take(item).rect);
+    }
+    mPendingItems.remove(item);
+}
+
+//
+// Private Functions
+//
+
+/*
+ * Returns the cached shadow, renders the item and blurs it if required. The
+ * item is filled with the shadow color before blurring, so the shadow is
+ * ready to be blitted without any further compositing.
+ */
+const ShadowLayer::Shadow& ShadowLayer::shadow(AbstractPainterItem* item)
+{
+    auto cached = mShadows.find(item);
+    if (cached != mShadows.end()) {
+        return cached.value();
+    }
+
+    Shadow itemShadow;
+    itemShadow.rect = shadowRect(item);
+    itemShadow.image = QImage(itemShadow.rect.size(), QImage::Format_ARGB32_Premultiplied);
+    itemShadow.image.fill(Qt::transparent);
+
+    QPainter painter(&itemShadow.image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.translate(mOffset - itemShadow.rect.topLeft());
+    painter.setTransform(item->sceneTransform(), true);
+    QStyleOptionGraphicsItem option;
+    option.exposedRect = item->boundingRect();
+    item->paint(&painter, &option, nullptr);
+    painter.resetTransform();
+    painter.setCompositionMode(QPainter::CompositionMode_SourceIn);
+    painter.fillRect(itemShadow.image.rect(), mColor);
+    painter.end();
+
+    ImageFilterHelper::boxBlur(itemShadow.image, mBlurRadius, mBlurPasses);
+
+    return mShadows.insert(item, itemShadow).value();
+}
+
+/*
+ * Area covered by the shadow of an item, the item bounds moved by the offset
+ * and grown by the distance the blur spreads.
+ */
+QRect ShadowLayer::shadowRect(AbstractPainterItem* item) const
+{
+    auto spread = mBlurRadius * mBlurPasses;
+    return item->sceneBoundingRect().toAlignedRect()
+           .translated(mOffset)
+           .adjusted(-spread, -spread, spread, spread);
+}
+
+void ShadowLayer::updatePendingItems()
+{
+    for (auto item : mPendingItems) {
+        if (item->scene() == scene()) {
+            update(shadowRect(item));
+        }
+    }
+    mPendingItems.clear();
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2017 Damir Porobic <https://github.com/damirporobic>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef SHADOWLAYER_H
+#define SHADOWLAYER_H
+
+#include <QGraphicsObject>
+#include <QGraphicsScene>
+#include <QStyleOptionGraphicsItem>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+
+#include "AbstractPainterItem.h"
+#include "src/helper/ImageFilterHelper.h"
+
+class ShadowLayer : public QGraphicsObject
+{
+public:
+    ShadowLayer(const QRectF &rect);
+    virtual QRectF boundingRect() const override;
+    virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *) override;
+    void markItemDirty(AbstractPainterItem *item);
+    void removeItem(AbstractPainterItem *item);
+
+private:
+    struct Shadow {
+        QImage image;
+        QRect  rect;
+    };
+
+    QRectF                                  mRect;
+    QHash<AbstractPainterItem *, Shadow>    mShadows;
+    QSet<AbstractPainterItem *>             mPendingItems;
+    const QColor                            mColor = QColor(63, 63, 63, 190);
+    const QPoint                            mOffset = QPoint(2, 2);
+    const int                               mBlurRadius = 2;
+    const int                               mBlurPasses = 3;
+
+    const Shadow &shadow(AbstractPainterItem *item);
+    QRect shadowRect(AbstractPainterItem *item) const;
+    void updatePendingItems();
+};
+
+#endif // SHADOWLAYER_H
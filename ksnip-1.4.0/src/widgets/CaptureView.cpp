@@ -193,6 +193,16 @@ void CaptureView::mouseMoveEvent(QMouseEvent* event)
 
 void CaptureView::drawForeground(QPainter* painter, const QRectF& rect)
 {
+    // Cropping only shrinks the scene rect, the cropped away parts of the
+    // capture are still on the scene and need to be covered.
+    auto outside = QRegion(rect.toAlignedRect()).subtracted(QRegion(sceneRect().toAlignedRect()));
+    if (!outside.isEmpty()) {
+        painter->save();
+        painter->setClipRegion(outside);
+        painter->fillRect(rect, viewport()->palette().brush(viewport()->backgroundRole()));
+        painter->restore();
+    }
+
     if (mIsCropping) {
         // Draw semi transparent background for not selected area
         painter->setClipRegion(QRegion(sceneRect().toRect()).subtracted(
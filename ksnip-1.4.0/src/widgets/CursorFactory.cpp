@@ -55,6 +55,8 @@ QCursor* CursorFactory::createPainterCursor(Painter::Modes mode, AbstractPainter
         return new QCursor(Qt::IBeamCursor);
     case Painter::Number:
         return new QCursor(Qt::PointingHandCursor);
+    case Painter::Redact:
+        return new CustomCursor(CustomCursor::Rect, QColor("gray"), mConfig->redactSize());
     case Painter::Erase:
         return new CustomCursor(CustomCursor::Rect, QColor("white"), mConfig->eraseSize());
     case Painter::Move:
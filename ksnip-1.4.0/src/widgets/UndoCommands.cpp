@@ -20,34 +20,101 @@
 #include "UndoCommands.h"
 
 //
-// Move Command
+// Abstract Undo Command
 //
-MoveCommand::MoveCommand(PaintArea* scene, const QPointF& newPos, QUndoCommand* parent)
-    : QUndoCommand(parent)
+AbstractUndoCommand::AbstractUndoCommand(QUndoCommand* parent)
+    : QUndoCommand(parent),
+      mIsApplied(false),
+      mIsDropped(false)
 {
-    mScene = scene;
-    for (auto item : scene->selectedItems()) {
-        if (item) {
-            Entry e(item, item->position(), newPos);
-            mItems.append(e);
+}
+
+/*
+ * Releases data that can be rebuilt, the command stays fully functional.
+ */
+void AbstractUndoCommand::compress()
+{
+}
+
+/*
+ * Writes data of items only held by the command to the device and releases
+ * it, the data is read back before the items are shown again. Called after
+ * compress() wasn't enough and before commands get dropped.
+ */
+void AbstractUndoCommand::spill(QIODevice*)
+{
+}
+
+/*
+ * Releases everything the command holds, afterwards the command can't be
+ * undone or redone anymore. Only called for the oldest applied commands.
+ */
+void AbstractUndoCommand::drop()
+{
+    mIsDropped = true;
+}
+
+bool AbstractUndoCommand::isDropped() const
+{
+    return mIsDropped;
+}
+
+/*
+ * Items that are on the scene are accounted to the scene, only items that are
+ * kept alive by the undo history are counted.
+ */
+qint64 AbstractUndoCommand::itemsByteCount(const QList<AbstractPainterItem*>& items)
+{
+    qint64 count = 0;
+    for (auto item : items) {
+        if (!item->scene()) {
+            count += item->byteCount();
         }
     }
+    return count;
 }
 
-bool MoveCommand::mergeWith(const QUndoCommand* command)
+void AbstractUndoCommand::compressItems(const QList<AbstractPainterItem*>& items)
 {
-    const auto moveCommand = static_cast<const MoveCommand*>(command);
-    auto items = moveCommand->mItems;
+    for (auto item : items) {
+        item->releaseCaches();
+    }
+}
+
+void AbstractUndoCommand::spillItems(const QList<AbstractPainterItem*>& items, QIODevice* device)
+{
+    for (auto item : items) {
+        item->spill(device);
+    }
+}
 
-    // Check if lists are equal, if not, don't merge
-    if (mItems != items) {
-        return false;
+void AbstractUndoCommand::restoreItems(const QList<AbstractPainterItem*>& items, PaintArea* scene)
+{
+    for (auto item : items) {
+        if (item->isSpilled()) {
+            item->restore(scene->spillFile());
+        }
     }
+}
 
+//
+// Move Command
+//
+/*
+ * Records a finished drag, the items are expected to be at their new position
+ * already, the old positions are the ones from before the drag started.
+ */
+MoveCommand::MoveCommand(PaintArea* scene,
+                         const QList<AbstractPainterItem*>& items,
+                         const QList<QPointF>& oldPositions,
+                         QUndoCommand* parent)
+    : AbstractUndoCommand(parent)
+{
+    mScene = scene;
     for (auto i = 0; i < items.count(); i++) {
-        mItems[i].newPos = items.at(i).item->position();
+        Entry e(items.at(i), oldPositions.at(i), items.at(i)->position());
+        mItems.append(e);
     }
-    return true;
 }
 
 void MoveCommand::undo()
@@ -56,6 +123,7 @@ void MoveCommand::undo()
         i.item->moveTo(i.oldPos);
     }
     mScene->update();
+    mIsApplied = false;
 }
 
 void MoveCommand::redo()
@@ -64,6 +132,18 @@ void MoveCommand::redo()
         i.item->moveTo(i.newPos);
     }
     mScene->update();
+    mIsApplied = true;
+}
+
+qint64 MoveCommand::byteCount() const
+{
+    return sizeof(MoveCommand) + mItems.count() * sizeof(Entry);
+}
+
+void MoveCommand::drop()
+{
+    mItems.clear();
+    AbstractUndoCommand::drop();
 }
 
 //
@@ -71,7 +151,7 @@ void MoveCommand::redo()
 //
 DeleteCommand::DeleteCommand(PaintArea* scene,
                              QUndoCommand* parent)
-    : QUndoCommand(parent)
+    : AbstractUndoCommand(parent)
 {
     mItems = scene->selectedItems();
     mScene = scene;
@@ -79,11 +159,13 @@ DeleteCommand::DeleteCommand(PaintArea* scene,
 
 void DeleteCommand::undo()
 {
+    restoreItems(mItems, mScene);
     for (auto item : mItems) {
         mScene->addItem(item);
         item->show();
     }
     mScene->update();
+    mIsApplied = false;
 }
 
 void DeleteCommand::redo()
@@ -97,6 +179,38 @@ void DeleteCommand::redo()
         item->hide();
     }
     mScene->update();
+    mIsApplied = true;
+}
+
+qint64 DeleteCommand::byteCount() const
+{
+    return sizeof(DeleteCommand) + itemsByteCount(mItems);
+}
+
+void DeleteCommand::compress()
+{
+    compressItems(mItems);
+}
+
+void DeleteCommand::spill(QIODevice* device)
+{
+    spillItems(mItems, device);
+}
+
+/*
+ * The commands that added the items are older, so they were dropped before
+ * and handed the items over to the scene. The deleted items can't come back
+ * anymore.
+ */
+void DeleteCommand::drop()
+{
+    for (auto item : mItems) {
+        if (!item->scene()) {
+            mScene->deleteOrphanedItem(item);
+        }
+    }
+    mItems.clear();
+    AbstractUndoCommand::drop();
 }
 
 //
@@ -105,7 +219,7 @@ void DeleteCommand::redo()
 AddCommand::AddCommand(AbstractPainterItem* painterItem,
                        PaintArea* scene,
                        QUndoCommand* parent)
-    : QUndoCommand(parent)
+    : AbstractUndoCommand(parent)
 {
     mScene = scene;
     mPainterItem = painterItem;
@@ -122,69 +236,88 @@ void AddCommand::undo()
     mScene->removeItem(mPainterItem);
     mPainterItem->hide();
     mScene->update();
+    mIsApplied = false;
 }
 
 void AddCommand::redo()
 {
+    if (mPainterItem->isSpilled()) {
+        mPainterItem->restore(mScene->spillFile());
+    }
     mScene->addItem(mPainterItem);
     mPainterItem->show();
     mScene->update();
+    mIsApplied = true;
+}
+
+/*
+ * While applied, the item is either on the scene or accounted to the command
+ * that deleted it.
+ */
+qint64 AddCommand::byteCount() const
+{
+    if (mIsApplied || !mPainterItem) {
+        return sizeof(AddCommand);
+    }
+    return sizeof(AddCommand) + mPainterItem->byteCount();
+}
+
+void AddCommand::compress()
+{
+    if (!mIsApplied && mPainterItem) {
+        mPainterItem->releaseCaches();
+    }
+}
+
+void AddCommand::spill(QIODevice* device)
+{
+    if (!mIsApplied && mPainterItem) {
+        mPainterItem->spill(device);
+    }
+}
+
+/*
+ * The item stays where it is, the scene takes over the ownership.
+ */
+void AddCommand::drop()
+{
+    mScene->adoptItems(QList<AbstractPainterItem*>() << mPainterItem);
+    mPainterItem = nullptr;
+    AbstractUndoCommand::drop();
 }
 
 //
 // Crop Command
 //
-CropCommand::CropCommand(QGraphicsPixmapItem* pixmapItem, const QRectF& newRect,
-                         PaintArea* scene, QUndoCommand* parent) : QUndoCommand(parent)
+/*
+ * Cropping only changes the part of the scene that is shown and exported, the
+ * capture and the painter items stay untouched, so no pixels are copied.
+ */
+CropCommand::CropCommand(const QRectF& newRect, PaintArea* scene, QUndoCommand* parent)
+    : AbstractUndoCommand(parent)
 {
     mScene = scene;
-    mPixmapItem = pixmapItem;
-    mNewRect = newRect;
+    mNewRect = newRect.normalized();
     mOldRect = mScene->sceneRect();
-    auto offset = mNewRect.topLeft() - mPixmapItem->offset();
-    mNewRect.moveTo(offset);
-    mOldPixmap = new QPixmap(pixmapItem->pixmap());
-    mNewPixmap = new QPixmap(pixmapItem->pixmap().copy(mNewRect.toRect()));
-    mOldOffset = pixmapItem->offset();
-    mNewOffset = offset;
-}
-
-CropCommand::~CropCommand()
-{
-    delete mOldPixmap;
-    delete mNewPixmap;
 }
 
 void CropCommand::undo()
 {
-    for (auto item : mScene->items()) {
-        AbstractPainterItem* baseItem = qgraphicsitem_cast<AbstractPainterItem*> (item);
-        if (baseItem) {
-            baseItem->moveTo(baseItem->position() + mOldOffset);
-        }
-    }
-
-    mPixmapItem->setPixmap(*mOldPixmap);
-    mPixmapItem->setOffset(mOldOffset);
     mScene->setSceneRect(mOldRect);
     mScene->fitViewToParent();
+    mIsApplied = false;
 }
 
 void CropCommand::redo()
 {
-    // Move all painter items to old offset, if this is not done, on the second
-    // crop the items are positioned incorrectly bug#27
-    for (auto item : mScene->items()) {
-        AbstractPainterItem* baseItem = qgraphicsitem_cast<AbstractPainterItem*> (item);
-        if (baseItem) {
-            baseItem->moveTo(baseItem->position() - mPixmapItem->offset());
-        }
-    }
-
-    mPixmapItem->setPixmap(*mNewPixmap);
-    mPixmapItem->setOffset(mNewOffset);
     mScene->setSceneRect(mNewRect);
     mScene->fitViewToParent();
+    mIsApplied = true;
+}
+
+qint64 CropCommand::byteCount() const
+{
+    return sizeof(CropCommand);
 }
 
 //
@@ -208,6 +341,7 @@ void ReOrderCommand::undo()
         mList->at(i).first->setZValue(mList->at(i).second->zValue());
         mList->at(i).second->setZValue(tmp);
     }
+    mIsApplied = false;
 }
 
 void ReOrderCommand::redo()
@@ -217,6 +351,18 @@ void ReOrderCommand::redo()
         item.first->setZValue(item.second->zValue());
         item.second->setZValue(tmp);
     }
+    mIsApplied = true;
+}
+
+qint64 ReOrderCommand::byteCount() const
+{
+    return sizeof(ReOrderCommand) + mList->count() * sizeof(QPair<QGraphicsItem*, QGraphicsItem*>);
+}
+
+void ReOrderCommand::drop()
+{
+    mList->clear();
+    AbstractUndoCommand::drop();
 }
 
 //
@@ -249,14 +395,46 @@ void PastCommand::undo()
         item->hide();
     }
     mScene->update();
+    mIsApplied = false;
 }
 
 void PastCommand::redo()
 {
+    restoreItems(mList, mScene);
     for (auto item : mList) {
         mScene->addItem(item);
         item->moveTo(mPosition);
         item->show();
     }
     mScene->update();
+    mIsApplied = true;
+}
+
+qint64 PastCommand::byteCount() const
+{
+    if (mIsApplied) {
+        return sizeof(PastCommand);
+    }
+    return sizeof(PastCommand) + itemsByteCount(mList);
+}
+
+void PastCommand::compress()
+{
+    if (!mIsApplied) {
+        compressItems(mList);
+    }
+}
+
+void PastCommand::spill(QIODevice* device)
+{
+    if (!mIsApplied) {
+        spillItems(mList, device);
+    }
+}
+
+void PastCommand::drop()
+{
+    mScene->adoptItems(mList);
+    mList.clear();
+    AbstractUndoCommand::drop();
 }
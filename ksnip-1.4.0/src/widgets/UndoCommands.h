@@ -28,11 +28,34 @@
 
 class PaintArea;
 
-class MoveCommand : public QUndoCommand
+/*
+ * Base for the PaintArea commands, reports the memory a command keeps alive
+ * and allows shrinking it when the undo history grows too large.
+ */
+class AbstractUndoCommand : public QUndoCommand
 {
 public:
-    enum { Id = 1234 };
+    explicit AbstractUndoCommand(QUndoCommand *parent = 0);
+    virtual qint64 byteCount() const = 0;
+    virtual void compress();
+    virtual void spill(QIODevice *device);
+    virtual void drop();
+    bool isDropped() const;
+
+protected:
+    bool mIsApplied;
+    bool mIsDropped;
+
+    static qint64 itemsByteCount(const QList<AbstractPainterItem *> &items);
+    static void compressItems(const QList<AbstractPainterItem *> &items);
+    static void spillItems(const QList<AbstractPainterItem *> &items, QIODevice *device);
+    static void restoreItems(const QList<AbstractPainterItem *> &items, PaintArea *scene);
+};
+
 
+class MoveCommand : public AbstractUndoCommand
+{
+public:
     struct Entry {
         AbstractPainterItem *item;
         QPointF oldPos;
@@ -51,14 +74,14 @@ public:
         }
     };
 
-    MoveCommand(PaintArea *scene, const QPointF &newPos, QUndoCommand *parent = 0);
+    MoveCommand(PaintArea *scene,
+                const QList<AbstractPainterItem *> &items,
+                const QList<QPointF> &oldPositions,
+                QUndoCommand *parent = 0);
     virtual void undo() override;
     virtual void redo() override;
-    virtual bool mergeWith(const QUndoCommand *command) override;
-    virtual int id() const override
-    {
-        return Id;
-    }
+    virtual qint64 byteCount() const override;
+    virtual void drop() override;
 
 private:
     QList<Entry> mItems;
@@ -66,12 +89,16 @@ private:
 };
 
 
-class DeleteCommand : public QUndoCommand
+class DeleteCommand : public AbstractUndoCommand
 {
 public:
     explicit DeleteCommand(PaintArea *scene, QUndoCommand *parent = 0);
     virtual void undo() override;
     virtual void redo() override;
+    virtual qint64 byteCount() const override;
+    virtual void compress() override;
+    virtual void spill(QIODevice *device) override;
+    virtual void drop() override;
 
 private:
     QList<AbstractPainterItem *>  mItems;
@@ -79,13 +106,17 @@ private:
 };
 
 
-class AddCommand : public QUndoCommand
+class AddCommand : public AbstractUndoCommand
 {
 public:
     AddCommand(AbstractPainterItem *painterItem, PaintArea *scene, QUndoCommand *parent = 0);
     ~AddCommand();
     virtual void undo() override;
     virtual void redo() override;
+    virtual qint64 byteCount() const override;
+    virtual void compress() override;
+    virtual void spill(QIODevice *device) override;
+    virtual void drop() override;
 
 private:
     AbstractPainterItem *mPainterItem;
@@ -94,45 +125,46 @@ private:
 };
 
 
-class CropCommand : public QUndoCommand
+class CropCommand : public AbstractUndoCommand
 {
 public:
-    CropCommand(QGraphicsPixmapItem *pixmap, const QRectF &newRect, PaintArea *scene, QUndoCommand *parent = 0);
-    ~CropCommand();
+    CropCommand(const QRectF &newRect, PaintArea *scene, QUndoCommand *parent = 0);
     virtual void undo() override;
     virtual void redo() override;
+    virtual qint64 byteCount() const override;
 
 private:
-    PaintArea           *mScene;
-    QPixmap             *mOldPixmap;
-    QPixmap             *mNewPixmap;
-    QGraphicsPixmapItem *mPixmapItem;
-    QRectF               mNewRect;
-    QRectF               mOldRect;
-    QPointF              mOldOffset;
-    QPointF              mNewOffset;
+    PaintArea *mScene;
+    QRectF     mNewRect;
+    QRectF     mOldRect;
 };
 
-class ReOrderCommand : public QUndoCommand
+class ReOrderCommand : public AbstractUndoCommand
 {
 public:
     ReOrderCommand(QList<QPair<QGraphicsItem*, QGraphicsItem*>> *list, QUndoCommand *parent = 0);
     ~ReOrderCommand();
     virtual void undo() override;
     virtual void redo() override;
+    virtual qint64 byteCount() const override;
+    virtual void drop() override;
 
 private:
     QList<QPair<QGraphicsItem*, QGraphicsItem*>> *mList;
 };
 
 
-class PastCommand : public QUndoCommand
+class PastCommand : public AbstractUndoCommand
 {
 public:
     PastCommand(PaintArea *scene, const QPointF& pos, QUndoCommand *parent = 0);
     ~PastCommand();
     virtual void undo() override;
     virtual void redo() override;
+    virtual qint64 byteCount() const override;
+    virtual void compress() override;
+    virtual void spill(QIODevice *device) override;
+    virtual void drop() override;
 
 private:
     QList<AbstractPainterItem*> mList;
@@ -92,6 +92,11 @@ void SettingsPickerConfigurator::setup(SettingsPicker* settingsPicker, Painter::
         settingsPicker->setColor(mConfig->numberColor());
         settingsPicker->setSize(mConfig->numberSize());
         break;
+    case Painter::Redact:
+        settingsPicker->setEnabled(true);
+        settingsPicker->addPopupSizeSlider(4, 40, 2);
+        settingsPicker->setSize(mConfig->redactSize());
+        break;
     case Painter::Erase:
         settingsPicker->setEnabled(true);
         settingsPicker->addPopupSizeSlider(1, 10, 1);